@@ -57,6 +57,15 @@
         setUploadCost: (currency)=> {
           setInnerText('ID_Renter_EstimatedUploadCost', currency);
         },
+        setUploadProgress: (uploadProgress)=> {
+          const activeCount = parseInt(uploadProgress.ActiveCount);
+          document.getElementById('ID_Progress').style.display = activeCount ? 'block' : 'none';
+          document.getElementById('ID_UploadProgress').value = parseInt(uploadProgress.Progress);
+
+          const etaSeconds = parseInt(uploadProgress.EtaSeconds);
+          const eta = (etaSeconds < 0) ? 'unknown' : (Math.floor(etaSeconds / 3600) + 'h ' + Math.floor((etaSeconds % 3600) / 60) + 'm ' + (etaSeconds % 60) + 's');
+          setInnerText('ID_UploadProgressTooltip', activeCount + ' uploading at ' + (parseInt(uploadProgress.BytesPerSecond) / 1024).toFixed(1) + ' KiB/s, ETA ' + eta);
+        },
         setAllowance: (allowance)=> {
           if (document.getElementById('renter_settings_window').classList.contains('hidden-element')) {
             setValue('ID_RenterSetFunds', allowance.Funds);
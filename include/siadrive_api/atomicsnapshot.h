@@ -0,0 +1,77 @@
+#ifndef _ATOMICSNAPSHOT_H
+#define _ATOMICSNAPSHOT_H
+
+#include <siacommon.h>
+#include <atomic>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Read-copy-update holder for an immutable value. Readers take a reference with a single atomic load and
+//	keep a consistent version for as long as they hold it; writers publish complete replacements. A
+//	replaced version is destroyed when its last reader releases it, so no reader ever sees freed memory.
+//	Values must not be modified once published.
+template<typename T>
+class CAtomicSnapshot
+{
+public:
+	CAtomicSnapshot() :
+		_version(0)
+	{
+	}
+
+public:
+	~CAtomicSnapshot()
+	{
+	}
+
+public:
+	CAtomicSnapshot(const CAtomicSnapshot&) = delete;
+	CAtomicSnapshot(CAtomicSnapshot&&) = delete;
+	CAtomicSnapshot& operator=(const CAtomicSnapshot&) = delete;
+	CAtomicSnapshot& operator=(CAtomicSnapshot&&) = delete;
+
+private:
+	std::shared_ptr<T> _current;
+	std::atomic<std::uint64_t> _version;
+
+public:
+	std::shared_ptr<T> Load() const
+	{
+		return std::atomic_load_explicit(&_current, std::memory_order_acquire);
+	}
+
+	// Returns the version that was replaced
+	std::shared_ptr<T> Exchange(std::shared_ptr<T> value)
+	{
+		auto ret = std::atomic_exchange_explicit(&_current, value, std::memory_order_acq_rel);
+		_version++;
+		return ret;
+	}
+
+	void Store(std::shared_ptr<T> value)
+	{
+		Exchange(value);
+	}
+
+	// Publishes 'value' only if 'expected' is still current; otherwise 'expected' receives the current version
+	bool CompareExchange(std::shared_ptr<T>& expected, std::shared_ptr<T> value)
+	{
+		const bool ret = std::atomic_compare_exchange_strong_explicit(&_current, &expected, value, std::memory_order_acq_rel, std::memory_order_acquire);
+		if (ret)
+		{
+			_version++;
+		}
+
+		return ret;
+	}
+
+	// Incremented on every publish - lets readers detect a new version without loading it
+	std::uint64_t GetVersion() const
+	{
+		return _version.load(std::memory_order_acquire);
+	}
+};
+
+NS_END(2)
+#endif //_ATOMICSNAPSHOT_H
@@ -2,6 +2,8 @@
 #define _AUTOTHREAD_H
 
 #include <siacommon.h>
+#include <condition_variable>
+#include <chrono>
 
 NS_BEGIN(Sia)
 NS_BEGIN(Api)
@@ -20,21 +22,31 @@ public:
 private:
 	std::unique_ptr<CSiaCurl> _siaCurl;
 	CSiaDriveConfig* _siaDriveConfig;
-#ifdef _WIN32
-	HANDLE _stopEvent;
-#endif
+	std::mutex _waitMutex;
+	std::condition_variable _waitNotify;
+	bool _stopRequested;
+	bool _wakeRequested;
+	bool _workReported;
+	bool _workPending;
+	bool _workActive;
+	std::chrono::milliseconds _interval;
 	std::unique_ptr<std::thread>  _thread;
 	std::mutex _startStopMutex;
 	std::function<void(const CSiaCurl&, CSiaDriveConfig*)> _AutoThreadCallback;
 
+private:
+	std::chrono::milliseconds GetNextInterval();
+
 protected:
 	virtual void AutoThreadCallback(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig);
+	void SetWorkPending(const bool& workPending, const bool& workActive);
 
 public:
   bool IsRunning() const;
 	SiaHostConfig GetHostConfig() const;
 	void StartAutoThread();
 	void StopAutoThread();
+	void Wake();
 };
 
 NS_END(2)
@@ -0,0 +1,181 @@
+#ifndef _BANDWIDTHPOLICY_H
+#define _BANDWIDTHPOLICY_H
+
+#include <siacommon.h>
+#include <siadriveconfig.h>
+#include <eventsystem.h>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Token bucket shaping for work handed to siad. siad transfers whole files, so bytes can't be metered
+//	as they're sent - instead observed transfer is charged against the bucket after the fact and new work
+//	is only admitted while the bucket is positive. Limits come from the config and may be overridden by
+//	time-of-day windows ("HH:MM-HH:MM=up/down" in KiB/s, ';' separated, 0 for unlimited).
+class SIADRIVE_EXPORTABLE CBandwidthPolicy
+{
+public:
+	enum class _BandwidthDirection : unsigned
+	{
+		Upload,
+		Download
+	};
+
+private:
+	typedef struct
+	{
+		std::uint32_t StartMinute;
+		std::uint32_t EndMinute;
+		std::uint64_t UploadBytesPerSecond;
+		std::uint64_t DownloadBytesPerSecond;
+	} WindowData;
+
+	typedef struct
+	{
+		std::uint64_t BytesPerSecond;
+		double Tokens;
+		std::chrono::steady_clock::time_point LastRefill;
+		std::deque<std::pair<std::chrono::steady_clock::time_point, std::uint64_t>> Usage;
+		std::uint64_t ReportedUsage;
+	} BucketData;
+
+public:
+	CBandwidthPolicy();
+
+public:
+	~CBandwidthPolicy();
+
+private:
+	std::mutex _bucketMutex;
+	std::condition_variable _bucketNotify;
+	std::string _schedule;
+	std::vector<WindowData> _windows;
+	BucketData _buckets[2];
+
+private:
+	static bool ParseSchedule(const std::string& schedule, std::vector<WindowData>& windows);
+	static std::uint32_t GetLocalMinute();
+	static void Refill(BucketData& bucket, const std::chrono::steady_clock::time_point& now);
+	static std::uint64_t GetUsageLocked(BucketData& bucket, const std::chrono::steady_clock::time_point& now);
+
+public:
+	static SString BandwidthDirectionToString(const _BandwidthDirection& direction);
+
+public:
+	void Update(CSiaDriveConfig* siaDriveConfig);
+	std::uint64_t GetLimit(const _BandwidthDirection& direction);
+	std::uint64_t GetUsage(const _BandwidthDirection& direction);
+	bool TryAcquire(const _BandwidthDirection& direction);
+	bool WaitForTokens(const _BandwidthDirection& direction, const std::uint32_t& timeoutMs);
+	void Consume(const _BandwidthDirection& direction, const std::uint64_t& bytes);
+	std::uint64_t GetAdmissionCount(const _BandwidthDirection& direction, const std::uint64_t& activeCount, const std::uint64_t& maxCount);
+};
+
+typedef CBandwidthPolicy::_BandwidthDirection BandwidthDirection;
+
+// Event Notifications
+class BandwidthLimitChanged :
+	public CEvent
+{
+public:
+	BandwidthLimitChanged(const BandwidthDirection& direction, const std::uint64_t& oldBytesPerSecond, const std::uint64_t& newBytesPerSecond) :
+		_direction(direction),
+		_oldBytesPerSecond(oldBytesPerSecond),
+		_newBytesPerSecond(newBytesPerSecond)
+	{
+
+	}
+
+public:
+	virtual ~BandwidthLimitChanged()
+	{
+	}
+
+private:
+	const BandwidthDirection _direction;
+	const std::uint64_t _oldBytesPerSecond;
+	const std::uint64_t _newBytesPerSecond;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"BandwidthLimitChanged|DIR|" + CBandwidthPolicy::BandwidthDirectionToString(_direction) + L"|OLD|" + SString::FromUInt64(_oldBytesPerSecond) + L"|NEW|" + SString::FromUInt64(_newBytesPerSecond);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new BandwidthLimitChanged(_direction, _oldBytesPerSecond, _newBytesPerSecond));
+	}
+};
+
+class BandwidthUsageChanged :
+	public CEvent
+{
+public:
+	BandwidthUsageChanged(const BandwidthDirection& direction, const std::uint64_t& bytesPerSecond, const std::uint64_t& limitBytesPerSecond) :
+		CEvent(EventLevel::Debug),
+		_direction(direction),
+		_bytesPerSecond(bytesPerSecond),
+		_limitBytesPerSecond(limitBytesPerSecond)
+	{
+
+	}
+
+public:
+	virtual ~BandwidthUsageChanged()
+	{
+	}
+
+private:
+	const BandwidthDirection _direction;
+	const std::uint64_t _bytesPerSecond;
+	const std::uint64_t _limitBytesPerSecond;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"BandwidthUsageChanged|DIR|" + CBandwidthPolicy::BandwidthDirectionToString(_direction) + L"|BPS|" + SString::FromUInt64(_bytesPerSecond) + L"|LIMIT|" + SString::FromUInt64(_limitBytesPerSecond);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new BandwidthUsageChanged(_direction, _bytesPerSecond, _limitBytesPerSecond));
+	}
+};
+
+class BandwidthScheduleInvalid :
+	public CEvent
+{
+public:
+	BandwidthScheduleInvalid(const SString& schedule) :
+		CEvent(EventLevel::Error),
+		_schedule(schedule)
+	{
+
+	}
+
+public:
+	virtual ~BandwidthScheduleInvalid()
+	{
+	}
+
+private:
+	const SString _schedule;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"BandwidthScheduleInvalid|SCHED|" + _schedule;
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new BandwidthScheduleInvalid(_schedule));
+	}
+};
+
+NS_END(2)
+#endif //_BANDWIDTHPOLICY_H
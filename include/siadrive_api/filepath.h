@@ -22,6 +22,7 @@ public:
 
 public:
   static SString FinalizePath(const SString& path);
+  static SString NormalizeSeparators(const SString& path, const SString::SChar& separator);
   static SString GetTempDirectory();
   static SString GetAppDataDirectory();
 
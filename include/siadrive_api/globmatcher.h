@@ -0,0 +1,52 @@
+#ifndef _GLOBMATCHER_H
+#define _GLOBMATCHER_H
+
+#include <siacommon.h>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Pre-compiled sia path pattern. '*' matches one or more characters and '?' matches zero or one
+//	character, neither crossing '/' - the semantics previously produced by the regex used for
+//	Sia_FindFiles. All other characters match literally. Matching does not allocate.
+class SIADRIVE_EXPORTABLE CGlobMatcher
+{
+private:
+	enum class _TokenType
+	{
+		Literal,
+		Star,
+		Question
+	};
+
+	typedef struct
+	{
+		_TokenType Type;
+		size_t Offset;
+		size_t Length;
+	} _Token;
+
+public:
+	explicit CGlobMatcher(const SString& pattern);
+
+public:
+	~CGlobMatcher();
+
+private:
+	const SString::String _pattern;
+	std::vector<_Token> _tokens;
+	bool _hasWildcards;
+
+private:
+	bool MatchTokens(const size_t& tokenIdx, const SString::SChar* text, const size_t& textLength) const;
+
+public:
+	static std::shared_ptr<const CGlobMatcher> Get(const SString& pattern);
+	bool HasWildcards() const;
+	bool IsMatch(const SString& path) const;
+};
+
+typedef std::shared_ptr<const CGlobMatcher> CGlobMatcherPtr;
+
+NS_END(2)
+#endif //_GLOBMATCHER_H
@@ -0,0 +1,51 @@
+#ifndef _JSONARRAYSTREAM_H
+#define _JSONARRAYSTREAM_H
+
+#include <siacommon.h>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Incremental parser for documents shaped like { "name": [ {...}, {...} ], ... }. Bytes are fed as they
+//	arrive and each element of the named top-level array is parsed and handed off individually, so the
+//	full document is never materialized.
+class SIADRIVE_EXPORTABLE CJsonArrayStream
+{
+public:
+	CJsonArrayStream(const std::string& arrayName, std::function<void(const json&)> elementCallback);
+
+public:
+	~CJsonArrayStream();
+
+private:
+	const std::string _arrayName;
+	std::function<void(const json&)> _elementCallback;
+	std::function<void(std::string&)> _rawElementCallback;
+	std::uint32_t _depth;
+	bool _inString;
+	bool _escape;
+	bool _keyCapture;
+	std::string _key;
+	std::string _lastKey;
+	bool _arrayActive;
+	bool _capturing;
+	bool _scalarElement;
+	std::string _element;
+	bool _complete;
+	bool _error;
+
+	Property(std::uint64_t, ElementCount, public, private)
+
+private:
+	void EmitElement();
+	void ProcessChar(const char& c);
+
+public:
+	bool Feed(const char* buffer, const size_t& length);
+	void SetRawElementCallback(std::function<void(std::string&)> rawElementCallback);
+	bool IsComplete() const;
+	bool HasError() const;
+};
+
+NS_END(2)
+#endif //_JSONARRAYSTREAM_H
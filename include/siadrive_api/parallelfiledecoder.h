@@ -0,0 +1,62 @@
+#ifndef _PARALLELFILEDECODER_H
+#define _PARALLELFILEDECODER_H
+
+#include <siacommon.h>
+#include <siafilestore.h>
+#include <condition_variable>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Decodes /renter/files elements on a pool of workers. Elements are grouped into batches; the first
+//	full batch starts the pool, so small listings are decoded inline. Batches are merged into the store
+//	in listing order once the response is complete.
+class SIADRIVE_EXPORTABLE CParallelFileDecoder
+{
+private:
+	typedef struct
+	{
+		std::string SiaPath;
+		std::uint64_t FileSize;
+		bool Available;
+		bool Renewing;
+		std::uint32_t Redundancy;
+		std::uint32_t UploadProgress;
+		std::uint32_t Expiration;
+	} DecodedFile;
+
+	typedef std::vector<std::string> Batch;
+
+public:
+	CParallelFileDecoder();
+	explicit CParallelFileDecoder(const int& workerCount);
+
+public:
+	~CParallelFileDecoder();
+
+private:
+	const int _workerCount;
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _notify;
+	std::deque<std::pair<std::size_t, Batch>> _pending;
+	std::vector<std::vector<DecodedFile>> _results;
+	Batch _batch;
+	bool _finished;
+	bool _error;
+
+private:
+	static bool DecodeBatch(const Batch& batch, std::vector<DecodedFile>& decoded);
+	void StoreResult(const std::size_t& sequence, std::vector<DecodedFile>& decoded, const bool& success);
+	void Worker();
+	void SubmitBatch();
+	void StopWorkers();
+
+public:
+	static int GetDefaultWorkerCount();
+	void Push(std::string& element);
+	bool Finish(CSiaFileStore& fileStore);
+};
+
+NS_END(2)
+#endif //_PARALLELFILEDECODER_H
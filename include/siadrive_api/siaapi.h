@@ -4,6 +4,11 @@
 #include <siacommon.h>
 #include <siacurl.h>
 #include <autothread.h>
+#include <eventsystem.h>
+#include <atomicsnapshot.h>
+#include <siafilestore.h>
+#include <siafileaggregates.h>
+#include <unordered_set>
 
 NS_BEGIN(Sia)
 NS_BEGIN(Api)
@@ -63,26 +68,30 @@ public:
 	};
 
 	class _CSiaFileTree;
-	class SIADRIVE_EXPORTABLE _CSiaFile :
-		public virtual CSiaBase
+	// Lightweight view of a single entry in a tree's CSiaFileStore
+	class SIADRIVE_EXPORTABLE _CSiaFile
 	{
 		friend CSiaApi;
 		friend _CSiaFileTree;
 
 	private:
-		explicit _CSiaFile(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, const json& fileJson);
+		explicit _CSiaFile(CSiaFileStorePtr fileStore, const std::uint32_t& index);
 
 	public:
-		virtual ~_CSiaFile();
+		~_CSiaFile();
 
-	// Properties
-		Property(SString, SiaPath, public, private)
-		Property(std::uint64_t, FileSize, public, private)
-		Property(bool, Available, public, private)
-		Property(bool, Renewing, public, private)
-		Property(std::uint32_t, Redundancy, public, private)
-		Property(std::uint32_t, UploadProgress, public, private)
-		Property(std::uint32_t, Expiration, public, private)
+	private:
+		const CSiaFileStorePtr _fileStore;
+		const std::uint32_t _index;
+
+	public:
+		SString GetSiaPath() const;
+		std::uint64_t GetFileSize() const;
+		bool GetAvailable() const;
+		bool GetRenewing() const;
+		std::uint32_t GetRedundancy() const;
+		std::uint32_t GetUploadProgress() const;
+		std::uint32_t GetExpiration() const;
 	};
 
 	class SIADRIVE_EXPORTABLE _CSiaFileTree :
@@ -96,20 +105,52 @@ public:
 		virtual ~_CSiaFileTree();
 
 	private:
-		std::shared_ptr<std::vector<std::shared_ptr<_CSiaFile>>> _fileList;
+		std::shared_ptr<CSiaFileStore> _fileStore;
+		mutable std::once_flag _fileListOnce;
+		mutable std::shared_ptr<std::vector<std::shared_ptr<_CSiaFile>>> _fileList;
+		std::unordered_map<SString, std::vector<SString>> _childDirectories;
+		std::unordered_map<SString, std::uint32_t> _directoryIds;
+		std::vector<std::vector<std::uint32_t>> _childFiles;
+		mutable std::once_flag _foldedDirectoriesOnce;
+		mutable std::unordered_map<std::wstring, SString> _foldedDirectories;
+
+	private:
+		void SetFileStore(std::shared_ptr<CSiaFileStore> fileStore);
+		static SString FormatToDirectoryKey(SString directory);
+		SString ResolveDirectory(const SString& directory) const;
 
 	public:
 		void BuildTree(const json& result);
 
+		SiaCurlError BuildTree(const CSiaCurl& siaCurl);
+
+		static SiaCurlError FetchShared(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, std::shared_ptr<_CSiaFileTree>& fileTree, const bool& force = false);
+
+		static bool LoadSnapshot(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, std::shared_ptr<_CSiaFileTree>& fileTree);
+
+		bool SaveSnapshot() const;
+
+		bool IsSnapshot() const;
+
+		CSiaFileStorePtr GetFileStore() const;
+
 		std::shared_ptr<std::vector<std::shared_ptr<_CSiaFile>>> GetFileList() const;
 
 		std::vector<std::shared_ptr<_CSiaFile>> Query(SString query) const;
 
 		std::shared_ptr<_CSiaFile> GetFile(const SString& siaPath) const;
 
+		std::shared_ptr<_CSiaFile> GetFileIgnoreCase(const SString& siaPath) const;
+
+		std::vector<CEventPtr> GetCaseCollisions() const;
+
+		std::vector<CEventPtr> Diff(const _CSiaFileTree& previous, std::vector<std::pair<std::uint32_t, std::uint32_t>>* changedRows = nullptr) const;
+
 		std::vector<SString> QueryDirectories(SString query) const;
 
 		bool FileExists(const SString& siaPath) const;
+
+		bool FileExistsIgnoreCase(const SString& siaPath, SString& resolvedSiaPath) const;
 	};
 
 	class SIADRIVE_EXPORTABLE _CSiaWallet :
@@ -165,24 +206,35 @@ public:
 		Property(SiaCurrency, Unspent, public, private)
 		Property(std::uint64_t, TotalUsedBytes, public, private)
 		Property(std::uint32_t, TotalUploadProgress, public, private)
+		Property(std::uint64_t, PendingUploadBytes, public, private)
+		Property(std::uint64_t, UnavailableFileCount, public, private)
     Property(std::uint64_t, Period, public, private)
     Property(std::uint64_t, RenewWindow, public, private)
 
 	private:
     _SiaRenterAllowance _currentAllowance;
-    std::shared_ptr<_CSiaFileTree> _fileTree;
-    std::mutex _fileTreeMutex;
+    CAtomicSnapshot<_CSiaFileTree> _fileTree;
+    std::mutex _fileTreeRefreshMutex;
+    bool _fileTreeSnapshotDirty;
+    std::unordered_set<std::wstring> _reportedCaseCollisions;
+    std::chrono::steady_clock::time_point _fileTreeSnapshotAttempted;
+    CSiaFileAggregates _fileAggregates;
 
 	private:
 		void Refresh(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig);
 
 	public:
     CSiaError<_SiaApiErrorCode> FileExists(const SString& siaPath, bool& exists) const;
+    CSiaError<_SiaApiErrorCode> FileExistsIgnoreCase(const SString& siaPath, bool& exists, SString& resolvedSiaPath) const;
     CSiaError<_SiaApiErrorCode> DownloadFile(const SString& siaPath, const SString& location) const;
     CSiaError<_SiaApiErrorCode> GetFileTree(std::shared_ptr<_CSiaFileTree>& siaFileTree) const;
     _SiaRenterAllowance GetAllowance() const;
     CSiaError<_SiaApiErrorCode> SetAllowance(const _SiaRenterAllowance& renterAllowance);
-    CSiaError<_SiaApiErrorCode> RefreshFileTree( );
+    CSiaError<_SiaApiErrorCode> RefreshFileTree(const bool& force = false);
+    bool LoadFileTreeSnapshot();
+    bool RegisterAggregate(const SString& name, CSiaFileAggregates::Contribution contribution);
+    std::int64_t GetAggregate(const SString& name) const;
+    std::uint64_t GetBytesExpiringBefore(const std::uint64_t& blockHeight) const;
 	};
 
 	class SIADRIVE_EXPORTABLE _CSiaConsensus : 
@@ -250,5 +302,220 @@ typedef std::vector<CSiaFilePtr> CSiaFileCollection;
 typedef std::shared_ptr<CSiaFileCollection> CSiaFileCollectionPtr;
 typedef CSiaApi::_CSiaFileTree CSiaFileTree;
 typedef std::shared_ptr<CSiaFileTree> CSiaFileTreePtr;
+
+// Event Notifications
+class SiaFileAdded :
+	public CEvent
+{
+public:
+	SiaFileAdded(const SString& siaPath, const std::uint64_t& fileSize) :
+		_siaPath(siaPath),
+		_fileSize(fileSize)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileAdded()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const std::uint64_t _fileSize;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileAdded|SP|" + _siaPath + L"|SZ|" + SString::FromUInt64(_fileSize);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileAdded(_siaPath, _fileSize));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+	const std::uint64_t& GetFileSize() const { return _fileSize; }
+};
+
+class SiaFileRemoved :
+	public CEvent
+{
+public:
+	SiaFileRemoved(const SString& siaPath) :
+		_siaPath(siaPath)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileRemoved()
+	{
+	}
+
+private:
+	const SString _siaPath;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileRemoved|SP|" + _siaPath;
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileRemoved(_siaPath));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+};
+
+class SiaFileCaseCollision :
+	public CEvent
+{
+public:
+	SiaFileCaseCollision(const SString& siaPath, const SString& collidingSiaPath) :
+		_siaPath(siaPath),
+		_collidingSiaPath(collidingSiaPath)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileCaseCollision()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const SString _collidingSiaPath;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileCaseCollision|SP|" + _siaPath + L"|COL|" + _collidingSiaPath;
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileCaseCollision(_siaPath, _collidingSiaPath));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+	const SString& GetCollidingSiaPath() const { return _collidingSiaPath; }
+};
+
+class SiaFileSizeChanged :
+	public CEvent
+{
+public:
+	SiaFileSizeChanged(const SString& siaPath, const std::uint64_t& oldSize, const std::uint64_t& newSize) :
+		_siaPath(siaPath),
+		_oldSize(oldSize),
+		_newSize(newSize)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileSizeChanged()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const std::uint64_t _oldSize;
+	const std::uint64_t _newSize;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileSizeChanged|SP|" + _siaPath + L"|OLD|" + SString::FromUInt64(_oldSize) + L"|NEW|" + SString::FromUInt64(_newSize);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileSizeChanged(_siaPath, _oldSize, _newSize));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+	const std::uint64_t& GetOldSize() const { return _oldSize; }
+	const std::uint64_t& GetNewSize() const { return _newSize; }
+};
+
+class SiaFileAvailabilityChanged :
+	public CEvent
+{
+public:
+	SiaFileAvailabilityChanged(const SString& siaPath, const bool& available) :
+		_siaPath(siaPath),
+		_available(available)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileAvailabilityChanged()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const bool _available;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileAvailabilityChanged|SP|" + _siaPath + L"|AV|" + SString::FromBool(_available);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileAvailabilityChanged(_siaPath, _available));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+	const bool& GetAvailable() const { return _available; }
+};
+
+class SiaFileUploadProgressChanged :
+	public CEvent
+{
+public:
+	SiaFileUploadProgressChanged(const SString& siaPath, const std::uint32_t& oldProgress, const std::uint32_t& newProgress) :
+		CEvent(EventLevel::Debug),
+		_siaPath(siaPath),
+		_oldProgress(oldProgress),
+		_newProgress(newProgress)
+	{
+
+	}
+
+public:
+	virtual ~SiaFileUploadProgressChanged()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const std::uint32_t _oldProgress;
+	const std::uint32_t _newProgress;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"SiaFileUploadProgressChanged|SP|" + _siaPath + L"|OLD|" + SString::FromUInt32(_oldProgress) + L"|NEW|" + SString::FromUInt32(_newProgress);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new SiaFileUploadProgressChanged(_siaPath, _oldProgress, _newProgress));
+	}
+
+	const SString& GetSiaPath() const { return _siaPath; }
+	const std::uint32_t& GetOldProgress() const { return _oldProgress; }
+	const std::uint32_t& GetNewProgress() const { return _newProgress; }
+};
 NS_END(2)
 #endif //_SIAAPI_H
\ No newline at end of file
@@ -94,6 +94,14 @@ const std::uint32_t SIA_DEFAULT_CONTRACT_LENGTH = SIA_BLOCKS_PER_MONTH * 3;
 
 #define DEFAULT_CONFIG_FILE_PATH L"./config/siadriveconfig.json"
 #define DEFAULT_RENTER_DB_FILE_PATH L"./config/renter_upload.db3"
+#define DEFAULT_FILE_TREE_SNAPSHOT_FILE_PATH L"./config/renter_files.snapshot"
+#define DEFAULT_VERSION_CACHE_TTL_SECS 300
+#define DEFAULT_FILE_TREE_FRESHNESS_MS 1500
+#define DEFAULT_UPLOAD_QUIET_PERIOD_SECS 5
+#define DEFAULT_SMALL_FILE_THRESHOLD_BYTES (4 * 1024 * 1024)
+#define DEFAULT_BUNDLE_TARGET_BYTES (40 * 1024 * 1024)
+#define DEFAULT_BUNDLE_COMPACTION_PERCENT 50
+#define DEFAULT_UPLOAD_STALL_TIMEOUT_MINS 10
 
 #define Property(type, name, get_access, set_access) \
 private:\
@@ -144,6 +152,7 @@ typedef struct
 	SString HostName;
 	std::uint16_t HostPort;
 	SString RequiredVersion;
+	std::uint32_t VersionCacheTtlSecs;
 } SiaHostConfig;
 
 template<typename T>
@@ -232,6 +241,8 @@ BOOL SIADRIVE_EXPORTABLE RetryDeleteFileIfExists(const SString& filePath);
 
 SString SIADRIVE_EXPORTABLE GenerateSha256(const SString& str);
 
+SString SIADRIVE_EXPORTABLE GenerateFileHash(const SString& filePath);
+
 BOOL SIADRIVE_EXPORTABLE RecurDeleteFilesByExtentsion(const SString& folder, const SString& extensionWithDot);
 
 #ifdef _WIN32
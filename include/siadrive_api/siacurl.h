@@ -2,6 +2,7 @@
 #define _SIACURL_H
 
 #include <siacommon.h>
+#include <future>
 
 NS_BEGIN(Sia)
 NS_BEGIN(Api)
@@ -21,6 +22,27 @@ public:
 
 	typedef std::unordered_map<SString, SString> _HttpParameters;
 
+	typedef struct
+	{
+		std::uint64_t PoolHits;
+		std::uint64_t PoolMisses;
+		std::uint64_t VersionCacheHits;
+		std::uint64_t VersionValidations;
+	} _SiaCurlMetrics;
+
+	typedef struct
+	{
+		CSiaError<_SiaCurlErrorCode> Error;
+		json Response;
+	} _SiaCurlResult;
+
+	// Asynchronous completions are invoked on the request engine thread and must not block on another
+	//	asynchronous request
+	typedef std::function<void(const _SiaCurlResult&)> _SiaCurlCallback;
+
+	// Receives raw response bytes as they arrive - return false to abort the transfer
+	typedef std::function<bool(const char* buffer, const size_t& length)> _SiaCurlStreamCallback;
+
 public:
 	CSiaCurl();
 
@@ -33,6 +55,9 @@ private:
 	Property(SiaHostConfig, HostConfig, public, public)
 
 public:
+	static void Startup();
+	static void Shutdown();
+	static _SiaCurlMetrics GetMetrics();
 	static SString UrlEncode(const SString& data, const bool& allowSlash = false);
 
 private:
@@ -40,20 +65,32 @@ private:
 
 private:
 	std::string ConstructPath(const SString& relativePath) const;
+	std::string ConstructUrl(const SString& path, const _HttpParameters& parameters) const;
+	static std::string ConstructPostFields(const _HttpParameters& parameters);
   CSiaError<_SiaCurlErrorCode> _Get(const SString& path, const _HttpParameters& parameters, json& response) const;
 	bool CheckVersion(CSiaError<_SiaCurlErrorCode>& error) const;
   CSiaError<_SiaCurlErrorCode> ProcessResponse(const int& res, const int& httpCode, const std::string& result, json& response) const;
+  void SubmitAsync(const bool& isPost, const SString& path, const _HttpParameters& parameters, _SiaCurlCallback callback) const;
 
 public:
 	SString GetServerVersion() const;
   CSiaError<_SiaCurlErrorCode> Get(const SString& path, json& result) const;
   CSiaError<_SiaCurlErrorCode> Get(const SString& path, const _HttpParameters& parameters, json& result) const;
   CSiaError<_SiaCurlErrorCode> Post(const SString& path, const _HttpParameters& parameters, json& response) const;
+  CSiaError<_SiaCurlErrorCode> GetStream(const SString& path, const _HttpParameters& parameters, _SiaCurlStreamCallback streamCallback) const;
+  void GetAsync(const SString& path, const _HttpParameters& parameters, _SiaCurlCallback callback) const;
+  void PostAsync(const SString& path, const _HttpParameters& parameters, _SiaCurlCallback callback) const;
+  std::future<_SiaCurlResult> GetAsync(const SString& path, const _HttpParameters& parameters = {}) const;
+  std::future<_SiaCurlResult> PostAsync(const SString& path, const _HttpParameters& parameters) const;
 };
 
 typedef CSiaCurl::_SiaCurlErrorCode SiaCurlErrorCode;
 typedef CSiaError<SiaCurlErrorCode> SiaCurlError;
 typedef CSiaCurl::_HttpParameters HttpParameters;
+typedef CSiaCurl::_SiaCurlMetrics SiaCurlMetrics;
+typedef CSiaCurl::_SiaCurlResult SiaCurlResult;
+typedef CSiaCurl::_SiaCurlCallback SiaCurlCallback;
+typedef CSiaCurl::_SiaCurlStreamCallback SiaCurlStreamCallback;
 
 NS_END(2)
 
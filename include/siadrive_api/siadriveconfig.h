@@ -16,11 +16,24 @@ public:
 	
 	Property(SString, FilePath, public, private)
 	JProperty(std::string, Renter_UploadDbFilePath, public, private, _configDocument)
+	JProperty(std::string, Renter_FileTreeSnapshotFilePath, public, public, _configDocument)
 	JProperty(std::string, TempFolder, public, private, _configDocument)
 	JProperty(std::string, CacheFolder, public, public, _configDocument)
   JProperty(std::uint16_t, HostPort, public, public, _configDocument)
   JProperty(std::uint8_t, MaxUploadCount, public, public, _configDocument)
+	JProperty(std::string, UploadOrderPolicy, public, public, _configDocument)
+	JProperty(std::uint32_t, UploadQuietPeriodSecs, public, public, _configDocument)
+	JProperty(bool, EnableSmallFilePacking, public, public, _configDocument)
+	JProperty(std::uint32_t, SmallFileThresholdBytes, public, public, _configDocument)
+	JProperty(std::uint32_t, BundleTargetBytes, public, public, _configDocument)
+	JProperty(std::uint8_t, BundleCompactionPercent, public, public, _configDocument)
+	JProperty(std::uint32_t, UploadLimitKBps, public, public, _configDocument)
+	JProperty(std::uint32_t, DownloadLimitKBps, public, public, _configDocument)
+	JProperty(std::string, BandwidthSchedule, public, public, _configDocument)
+	JProperty(std::uint32_t, UploadStallTimeoutMins, public, public, _configDocument)
 	JProperty(std::string, HostNameOrIp, public, public, _configDocument)
+  JProperty(std::uint32_t, VersionCacheTtlSecs, public, public, _configDocument)
+  JProperty(std::uint32_t, FileTreeFreshnessMs, public, public, _configDocument)
 
 private:
 	json _configDocument;
@@ -0,0 +1,52 @@
+#ifndef _SIAFILEAGGREGATES_H
+#define _SIAFILEAGGREGATES_H
+
+#include <siafilestore.h>
+#include <map>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Running totals over a renter file listing. Each aggregate kind is the sum of a per-file contribution,
+//	so it can be maintained from the rows that changed between two listings instead of rescanning.
+//	Expiring bytes are kept as a histogram by expiration height, since the window moves with the chain.
+class SIADRIVE_EXPORTABLE CSiaFileAggregates
+{
+public:
+	typedef std::function<std::int64_t(const CSiaFileStore&, const std::uint32_t&)> Contribution;
+
+public:
+	CSiaFileAggregates();
+
+public:
+	~CSiaFileAggregates();
+
+public:
+	static const SString TotalUsedBytes;
+	static const SString TotalUploadProgress;
+	static const SString PendingUploadBytes;
+	static const SString UnavailableFileCount;
+
+private:
+	mutable std::mutex _aggregateMutex;
+	std::vector<Contribution> _contributions;
+	std::unordered_map<SString, std::size_t> _kindIndex;
+	std::vector<std::int64_t> _values;
+	std::map<std::uint32_t, std::uint64_t> _expiringBytes;
+	std::uint64_t _fileCount;
+	CSiaFileStorePtr _fileStore;
+
+private:
+	void AddFile(const CSiaFileStore& fileStore, const std::uint32_t& index, const std::int64_t& sign);
+
+public:
+	bool Register(const SString& name, Contribution contribution);
+	void Reset(CSiaFileStorePtr fileStore);
+	void Apply(CSiaFileStorePtr fileStore, const CSiaFileStore& previous, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& changedRows);
+	std::int64_t Get(const SString& name) const;
+	std::uint64_t GetFileCount() const;
+	std::uint64_t GetBytesExpiringBefore(const std::uint64_t& blockHeight) const;
+};
+
+NS_END(2)
+#endif //_SIAFILEAGGREGATES_H
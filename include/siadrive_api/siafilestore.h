@@ -0,0 +1,142 @@
+#ifndef _SIAFILESTORE_H
+#define _SIAFILESTORE_H
+
+#include <siacommon.h>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Packed, column oriented storage for /renter/files metadata. Paths are kept as UTF-8 in two arenas:
+//	directories are interned once and each file stores only its directory id and name. Lookup by sia path
+//	uses an open addressed table of file indexes, so no per-file heap objects exist once the store is sealed.
+//	A sealed store can be written as a versioned snapshot and later served directly from a read-only
+//	memory mapping of that file.
+class SIADRIVE_EXPORTABLE CSiaFileStore
+{
+private:
+	enum _FileFlags : std::uint8_t
+	{
+		Available = 0x01,
+		Renewing = 0x02
+	};
+
+	typedef struct
+	{
+		char Magic[8];
+		std::uint32_t Version;
+		std::uint32_t FileCount;
+		std::uint32_t DirectoryCount;
+		std::uint32_t PathSlotCount;
+		std::uint64_t DirectoryArenaSize;
+		std::uint64_t NameArenaSize;
+		std::uint64_t TagSize;
+		std::uint64_t TotalSize;
+	} _SnapshotHeader;
+
+	typedef struct
+	{
+		std::uint64_t Tag;
+		std::uint64_t FileSizes;
+		std::uint64_t DirectoryOffsets;
+		std::uint64_t NameOffsets;
+		std::uint64_t DirectoryIds;
+		std::uint64_t Redundancy;
+		std::uint64_t UploadProgress;
+		std::uint64_t Expiration;
+		std::uint64_t PathSlots;
+		std::uint64_t Flags;
+		std::uint64_t DirectoryArena;
+		std::uint64_t NameArena;
+		std::uint64_t End;
+	} _SnapshotLayout;
+
+public:
+	CSiaFileStore();
+
+public:
+	static const std::uint32_t NoIndex;
+
+public:
+	~CSiaFileStore();
+
+private:
+	// Build-time storage - released or replaced by a mapped view once sealed
+	std::string _directoryArena;
+	std::vector<std::uint32_t> _directoryOffsets;
+	std::unordered_map<std::string, std::uint32_t> _directoryLookup;
+	std::string _nameArena;
+	std::vector<std::uint32_t> _nameOffsets;
+	std::vector<std::uint32_t> _directoryIds;
+	std::vector<std::uint64_t> _fileSizes;
+	std::vector<std::uint32_t> _redundancy;
+	std::vector<std::uint32_t> _uploadProgress;
+	std::vector<std::uint32_t> _expiration;
+	std::vector<std::uint8_t> _flags;
+	std::vector<std::uint32_t> _pathSlots;
+	std::shared_ptr<const void> _mappedView;
+	std::uint64_t _mappedSize;
+
+	// Column views - point into the vectors above or into the mapped snapshot
+	std::uint32_t _fileCount;
+	std::uint32_t _directoryCount;
+	std::uint32_t _pathSlotCount;
+	const char* _directoryArenaData;
+	const std::uint32_t* _directoryOffsetsData;
+	const char* _nameArenaData;
+	const std::uint32_t* _nameOffsetsData;
+	const std::uint32_t* _directoryIdsData;
+	const std::uint64_t* _fileSizesData;
+	const std::uint32_t* _redundancyData;
+	const std::uint32_t* _uploadProgressData;
+	const std::uint32_t* _expirationData;
+	const std::uint8_t* _flagsData;
+	const std::uint32_t* _pathSlotsData;
+
+	// Case-folded lookup - built on seal, or on first use for a mapped snapshot
+	mutable std::once_flag _foldedOnce;
+	mutable std::vector<std::uint64_t> _foldedHashes;
+	mutable std::vector<std::uint32_t> _foldedSlots;
+	mutable std::vector<std::pair<std::uint32_t, std::uint32_t>> _caseCollisions;
+
+private:
+	static _SnapshotLayout CreateSnapshotLayout(const _SnapshotHeader& header);
+	std::uint32_t InternDirectory(const std::string& directory);
+	void BindColumns();
+	std::uint64_t HashPath(const std::uint32_t& index) const;
+	bool PathEquals(const std::uint32_t& index, const std::string& siaPath) const;
+	static std::uint64_t HashFolded(const std::wstring& foldedPath);
+	void BuildFoldedIndex() const;
+
+public:
+	static std::wstring FoldCase(const std::string& siaPath);
+	static std::shared_ptr<CSiaFileStore> LoadSnapshot(const SString& filePath, const std::string& tag);
+	std::uint32_t Add(const json& fileJson);
+	std::uint32_t Add(const std::string& siaPath, const std::uint64_t& fileSize, const bool& available, const bool& renewing, const std::uint32_t& redundancy, const std::uint32_t& uploadProgress, const std::uint32_t& expiration);
+	void Seal();
+	bool SaveSnapshot(const SString& filePath, const std::string& tag) const;
+	bool Find(const std::string& siaPath, std::uint32_t& index) const;
+	bool Find(const SString& siaPath, std::uint32_t& index) const;
+	bool FindIgnoreCase(const SString& siaPath, std::uint32_t& index) const;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> GetCaseCollisions() const;
+	std::string GetSiaPathUtf8(const std::uint32_t& index) const;
+	SString GetSiaPath(const std::uint32_t& index) const;
+	std::string GetDirectoryUtf8(const std::uint32_t& directoryId) const;
+	std::size_t GetMemoryUsage() const;
+	bool IsMapped() const;
+	bool RowEquals(const std::uint32_t& index, const CSiaFileStore& other, const std::uint32_t& otherIndex) const;
+
+	inline std::uint32_t GetCount() const { return _fileCount; }
+	inline std::uint32_t GetDirectoryCount() const { return _directoryCount; }
+	inline const std::uint32_t& GetDirectoryId(const std::uint32_t& index) const { return _directoryIdsData[index]; }
+	inline const std::uint64_t& GetFileSize(const std::uint32_t& index) const { return _fileSizesData[index]; }
+	inline bool GetAvailable(const std::uint32_t& index) const { return (_flagsData[index] & _FileFlags::Available) != 0; }
+	inline bool GetRenewing(const std::uint32_t& index) const { return (_flagsData[index] & _FileFlags::Renewing) != 0; }
+	inline const std::uint32_t& GetRedundancy(const std::uint32_t& index) const { return _redundancyData[index]; }
+	inline const std::uint32_t& GetUploadProgress(const std::uint32_t& index) const { return _uploadProgressData[index]; }
+	inline const std::uint32_t& GetExpiration(const std::uint32_t& index) const { return _expirationData[index]; }
+};
+
+typedef std::shared_ptr<const CSiaFileStore> CSiaFileStorePtr;
+
+NS_END(2)
+#endif //_SIAFILESTORE_H
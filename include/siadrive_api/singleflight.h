@@ -0,0 +1,114 @@
+#ifndef _SINGLEFLIGHT_H
+#define _SINGLEFLIGHT_H
+
+#include <siacommon.h>
+#include <future>
+#include <chrono>
+#include <atomic>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Coalesces identical requests: callers asking for a key while a request is in flight wait for and
+//	share its result, as do callers arriving within the freshness window after it completed.
+template<typename T>
+class CSingleFlight
+{
+private:
+	typedef struct
+	{
+		std::shared_future<T> Result;
+		bool Complete;
+		std::chrono::steady_clock::time_point CompletedAt;
+	} FlightData;
+
+public:
+	CSingleFlight() :
+		_executed(0),
+		_shared(0)
+	{
+	}
+
+public:
+	~CSingleFlight()
+	{
+	}
+
+private:
+	std::mutex _flightMutex;
+	std::unordered_map<SString, std::shared_ptr<FlightData>> _flights;
+	std::atomic<std::uint64_t> _executed;
+	std::atomic<std::uint64_t> _shared;
+
+public:
+	// 'request' returns false in its second parameter when the result must not be shared after completion
+	T Do(const SString& key, const std::uint32_t& freshnessMs, std::function<T(bool&)> request)
+	{
+		std::shared_ptr<FlightData> flight;
+		std::shared_ptr<std::promise<T>> promise;
+		{
+			std::lock_guard<std::mutex> l(_flightMutex);
+			auto it = _flights.find(key);
+			if ((it != _flights.end()) && (!it->second->Complete || ((std::chrono::steady_clock::now() - it->second->CompletedAt) < std::chrono::milliseconds(freshnessMs))))
+			{
+				flight = it->second;
+			}
+			else
+			{
+				promise.reset(new std::promise<T>());
+				flight.reset(new FlightData({ promise->get_future().share(), false, std::chrono::steady_clock::now() }));
+				_flights[key] = flight;
+			}
+		}
+
+		if (promise)
+		{
+			_executed++;
+			bool shareable = true;
+			try
+			{
+				promise->set_value(request(shareable));
+			}
+			catch (...)
+			{
+				shareable = false;
+				promise->set_exception(std::current_exception());
+			}
+
+			std::lock_guard<std::mutex> l(_flightMutex);
+			flight->Complete = true;
+			flight->CompletedAt = std::chrono::steady_clock::now();
+			auto it = _flights.find(key);
+			if (!shareable && (it != _flights.end()) && (it->second == flight))
+			{
+				_flights.erase(it);
+			}
+		}
+		else
+		{
+			_shared++;
+		}
+
+		return flight->Result.get();
+	}
+
+	// Next request for key starts a new request instead of joining or reusing an earlier one
+	void Forget(const SString& key)
+	{
+		std::lock_guard<std::mutex> l(_flightMutex);
+		_flights.erase(key);
+	}
+
+	std::uint64_t GetExecutedCount() const
+	{
+		return _executed;
+	}
+
+	std::uint64_t GetSharedCount() const
+	{
+		return _shared;
+	}
+};
+
+NS_END(2)
+#endif //_SINGLEFLIGHT_H
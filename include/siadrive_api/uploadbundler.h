@@ -0,0 +1,182 @@
+#ifndef _UPLOADBUNDLER_H
+#define _UPLOADBUNDLER_H
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <eventsystem.h>
+#include <filepath.h>
+#include <unordered_set>
+
+NS_BEGIN(Sia)
+NS_BEGIN(Api)
+
+// Packs small files into larger bundle objects that are uploaded to Sia in their place. Bundles and
+//	their members are indexed in the upload database - callers serialize access to it. Callers copy files
+//	into the open bundle themselves, so the copying needn't be serialized, then record them with Pack().
+//	Member paths are also kept in memory so IsMember() can be answered without the database.
+class SIADRIVE_EXPORTABLE CUploadBundler
+{
+public:
+	enum class _BundleStatus : unsigned
+	{
+		Open,
+		Sealed,
+		Retired
+	};
+
+	typedef struct
+	{
+		std::int64_t Id;
+		SString SiaPath;
+		SString FilePath;
+		std::uint64_t Size;
+		std::uint64_t LiveBytes;
+	} BundleData;
+
+	typedef struct
+	{
+		BundleData Bundle;
+		std::uint64_t Offset;
+		std::uint64_t Length;
+	} MemberData;
+
+public:
+	CUploadBundler(SQLite::Database& database, const SString& bundleFolder);
+
+public:
+	~CUploadBundler();
+
+public:
+	static const SString BundleSiaFolder;
+
+private:
+	SQLite::Database& _database;
+	const FilePath _bundleFolder;
+	std::mutex _memberMutex;
+	std::unordered_set<std::wstring> _memberPaths;
+
+private:
+	static bool ReadBundle(SQLite::Statement& query, BundleData& bundle);
+
+public:
+	static bool IsBundlePath(const SString& siaPath);
+	static bool CopyFileRange(const SString& sourcePath, const std::uint64_t& offset, const std::uint64_t& length, const SString& destPath, std::uint64_t& destOffset);
+	static bool ExtractMember(const MemberData& member, const SString& destPath);
+
+public:
+	bool GetOpenBundle(BundleData& bundle);
+	bool Pack(const SString& siaPath, const std::uint64_t& offset, const std::uint64_t& length, BundleData& bundle);
+	bool RemoveMember(const SString& siaPath);
+	bool GetMember(const SString& siaPath, MemberData& member);
+	bool IsMember(const SString& siaPath);
+	bool SealIfReady(const std::uint64_t& targetBytes, const std::uint32_t& maxOpenSecs, BundleData& bundle);
+	bool GetCompactionCandidate(const std::uint8_t& stalePercent, const unsigned& uploadCompleteStatus, BundleData& bundle);
+	std::vector<std::pair<SString, MemberData>> GetMembers(const BundleData& bundle);
+	bool Retire(const BundleData& bundle, const std::int64_t& replacedById);
+	bool GetRetiredBundle(const unsigned& uploadCompleteStatus, BundleData& bundle);
+	bool DeleteBundle(const BundleData& bundle);
+};
+
+typedef CUploadBundler::_BundleStatus BundleStatus;
+
+// Event Notifications
+class FilePackedIntoBundle :
+	public CEvent
+{
+public:
+	FilePackedIntoBundle(const SString& siaPath, const SString& bundleSiaPath) :
+		_siaPath(siaPath),
+		_bundleSiaPath(bundleSiaPath)
+	{
+
+	}
+
+public:
+	virtual ~FilePackedIntoBundle()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const SString _bundleSiaPath;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"FilePackedIntoBundle|SP|" + _siaPath + L"|BSP|" + _bundleSiaPath;
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new FilePackedIntoBundle(_siaPath, _bundleSiaPath));
+	}
+};
+
+class BundleSealed :
+	public CEvent
+{
+public:
+	BundleSealed(const SString& bundleSiaPath, const std::uint64_t& size) :
+		_bundleSiaPath(bundleSiaPath),
+		_size(size)
+	{
+
+	}
+
+public:
+	virtual ~BundleSealed()
+	{
+	}
+
+private:
+	const SString _bundleSiaPath;
+	const std::uint64_t _size;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"BundleSealed|BSP|" + _bundleSiaPath + L"|SZ|" + SString::FromUInt64(_size);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new BundleSealed(_bundleSiaPath, _size));
+	}
+};
+
+class BundleCompacted :
+	public CEvent
+{
+public:
+	BundleCompacted(const SString& bundleSiaPath, const std::uint64_t& liveBytes, const std::uint64_t& size) :
+		_bundleSiaPath(bundleSiaPath),
+		_liveBytes(liveBytes),
+		_size(size)
+	{
+
+	}
+
+public:
+	virtual ~BundleCompacted()
+	{
+	}
+
+private:
+	const SString _bundleSiaPath;
+	const std::uint64_t _liveBytes;
+	const std::uint64_t _size;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"BundleCompacted|BSP|" + _bundleSiaPath + L"|LIVE|" + SString::FromUInt64(_liveBytes) + L"|SZ|" + SString::FromUInt64(_size);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new BundleCompacted(_bundleSiaPath, _liveBytes, _size));
+	}
+};
+
+NS_END(2)
+#endif //_UPLOADBUNDLER_H
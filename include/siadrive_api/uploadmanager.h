@@ -3,15 +3,24 @@
 
 #include <SQLiteCpp/Database.h>
 #include <SQLiteCpp/Exception.h>
+#include <SQLiteCpp/Statement.h>
 #include <autothread.h>
 #include <deque>
+#include <unordered_set>
+#include <atomic>
+#include <chrono>
 #include <siacurl.h>
 #include <eventsystem.h>
 #include <filepath.h>
+#include <uploadbundler.h>
+#include <bandwidthpolicy.h>
+#include <singleflight.h>
 
 NS_BEGIN(Sia)
 NS_BEGIN(Api)
 
+class CSiaFileStore;
+
 class SIADRIVE_EXPORTABLE CUploadManager :
 	public CAutoThread
 {
@@ -22,7 +31,8 @@ public:
 		Queued,
 		Uploading,
 		Complete,
-		Error
+		Error,
+		Pending
 	};
 
 	enum class _UploadErrorCode
@@ -32,7 +42,33 @@ public:
 		DatabaseError
 	};
 
+	enum class _UploadOrderPolicy
+	{
+		OldestFirst,
+		SmallestFirst,
+		Priority,
+		FairShare
+	};
+
+	typedef struct
+	{
+		SString SiaPath;
+		std::uint64_t FileSize;
+		std::uint64_t UploadedBytes;
+		std::uint64_t BytesPerSecond;
+		// -1 until a rate has been observed
+		std::int64_t EtaSeconds;
+	} UploadProgressData;
+
 private:
+	typedef struct
+	{
+		std::uint64_t FileSize;
+		std::uint64_t UploadedBytes;
+		std::chrono::steady_clock::time_point LastProgress;
+		std::deque<std::pair<std::chrono::steady_clock::time_point, std::uint64_t>> Samples;
+	} UploadTrackingData;
+
 	typedef struct
 	{
 		std::uint64_t Id;
@@ -42,6 +78,13 @@ private:
 		_UploadStatus Status;
 	} UploadData;
 
+	// Shared with in-flight delete completions, which may outlive the manager
+	typedef struct
+	{
+		std::mutex Mutex;
+		std::unordered_set<std::wstring> SiaPaths;
+	} PendingRemovalData;
+
 public:
 	CUploadManager(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig);
 
@@ -52,27 +95,77 @@ private:
   CSiaDriveConfig* _siaDriveConfig;
 	SQLite::Database _uploadDatabase;
 	std::mutex _uploadMutex;
+	std::unordered_map<std::string, std::unique_ptr<SQLite::Statement>> _statementCache;
+	std::unique_ptr<CUploadBundler> _uploadBundler;
+	CSingleFlight<bool> _bundleDownloads;
+	CBandwidthPolicy _bandwidthPolicy;
+	std::unordered_map<SString, UploadTrackingData> _uploadTracking;
+	std::mutex _progressMutex;
+	std::vector<UploadProgressData> _uploadProgress;
+	UploadProgressData _totalUploadProgress;
+	bool _reconciled;
+	std::unordered_set<std::string> _missingFromSia;
+	std::chrono::steady_clock::time_point _missingCheckedAt;
+	std::deque<std::pair<std::chrono::steady_clock::time_point, std::uint64_t>> _completedUploads;
+	std::atomic<std::uint64_t> _queueDepth;
+	std::atomic<std::uint64_t> _inFlightCount;
+	std::atomic<std::uint64_t> _bytesPerSecond;
+	std::atomic<std::uint64_t> _pendingCount;
+	std::atomic<std::uint64_t> _avoidedUploadCount;
+	std::atomic<std::uint64_t> _dedupBytesSaved;
+	std::shared_ptr<PendingRemovalData> _pendingRemovals;
 
 private:
   CSiaDriveConfig* GetSiaDriveConfig() const { return _siaDriveConfig; }
 
+	SQLite::Statement& GetStatement(const std::string& sql);
 	bool HandleFileRemove(const CSiaCurl& siaCurl, const SString& siaPath);
-	void DeleteFilesRemovedFromSia(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, const bool& isStartup = false);
+	bool IsRemovalPending(const SString& siaPath);
+	bool IsContentHashNeeded(const SString& siaPath, const std::uint64_t& fileSize);
+	void HashDueUploads(CSiaDriveConfig* siaDriveConfig);
+	CSiaError<_UploadErrorCode> AddOrUpdateLocked(const SString& siaPath, const SString& filePath, const std::uint64_t& fileSize, const SString& contentHash);
+	std::vector<std::pair<SString, SString>> QueryUploads(const std::string& sql, const std::uint64_t& count, const std::uint64_t& smallFileSize);
+	std::vector<std::pair<SString, SString>> GetNextUploads(const _UploadOrderPolicy& uploadOrderPolicy, const std::uint64_t& count, const std::uint64_t& smallFileSize);
+	bool DeleteFilesRemovedFromSia(const CSiaFileStore& fileStore, const std::uint32_t& freshnessMs);
+	void SyncPackedUploads();
+	void PackSmallFiles(CSiaDriveConfig* siaDriveConfig);
+	void RemoveRetiredBundles(const CSiaCurl& siaCurl);
+	void CompactBundles(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig);
+	bool DownloadBundle(const CSiaCurl& siaCurl, const CUploadBundler::BundleData& bundle, std::uint64_t& downloadedBytes);
+	std::uint64_t TrackUploadProgress(const SString& siaPath, const std::uint64_t& fileSize, const std::uint64_t& uploadedBytes, std::unordered_map<SString, UploadTrackingData>& tracking);
+	void UpdateUploadProgress(const std::uint64_t& queuedBytes);
+	void UpdateMetrics(const std::uint64_t& queueDepth, const std::uint64_t& inFlightCount, const std::uint64_t& completedBytes);
 
 protected:
 	virtual void AutoThreadCallback(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig) override;
 
 public:
 	static SString UploadStatusToString(const _UploadStatus& uploadStatus);
+	static SString UploadOrderPolicyToString(const _UploadOrderPolicy& uploadOrderPolicy);
+	static _UploadOrderPolicy UploadOrderPolicyFromString(const SString& uploadOrderPolicy);
 
 public:
   CSiaError<_UploadErrorCode> AddOrUpdate(const SString& siaPath, SString filePath);
+  CSiaError<_UploadErrorCode> AddOrUpdate(const std::vector<std::pair<SString, SString>>& uploads);
 	_UploadStatus GetUploadStatus(const SString& siaPath);
   CSiaError<_UploadErrorCode> Remove(const SString& siaPath);
+	CSiaError<_UploadErrorCode> SetFolderPriority(const SString& siaFolder, const std::int32_t& priority);
+	bool IsPackedFile(const SString& siaPath);
+	bool ExtractPackedFile(const SString& siaPath, const SString& destFilePath, std::uint64_t& downloadedBytes);
+	CBandwidthPolicy& GetBandwidthPolicy() { return _bandwidthPolicy; }
+	std::uint64_t GetQueueDepth() const { return _queueDepth; }
+	std::uint64_t GetInFlightCount() const { return _inFlightCount; }
+	std::uint64_t GetBytesPerSecond() const { return _bytesPerSecond; }
+	std::uint64_t GetPendingCount() const { return _pendingCount; }
+	std::uint64_t GetAvoidedUploadCount() const { return _avoidedUploadCount; }
+	std::uint64_t GetDedupBytesSaved() const { return _dedupBytesSaved; }
+	std::vector<UploadProgressData> GetUploadProgress();
+	UploadProgressData GetTotalUploadProgress();
 };
 
 typedef CUploadManager::_UploadStatus UploadStatus;
 typedef CUploadManager::_UploadErrorCode UploadErrorCode;
+typedef CUploadManager::_UploadOrderPolicy UploadOrderPolicy;
 typedef CSiaError<CUploadManager::_UploadErrorCode> UploadError;
 
 // Event Notifications
@@ -108,6 +201,187 @@ public:
 	}
 };
 
+class UploadQueueStatusChanged :
+	public CEvent
+{
+public:
+	UploadQueueStatusChanged(const std::uint64_t& queueDepth, const std::uint64_t& inFlightCount, const std::uint64_t& bytesPerSecond) :
+		CEvent(EventLevel::Debug),
+		_queueDepth(queueDepth),
+		_inFlightCount(inFlightCount),
+		_bytesPerSecond(bytesPerSecond)
+	{
+
+	}
+
+public:
+	virtual ~UploadQueueStatusChanged()
+	{
+	}
+
+private:
+	const std::uint64_t _queueDepth;
+	const std::uint64_t _inFlightCount;
+	const std::uint64_t _bytesPerSecond;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"UploadQueueStatusChanged|QUEUED|" + SString::FromUInt64(_queueDepth) + L"|ACTIVE|" + SString::FromUInt64(_inFlightCount) + L"|BPS|" + SString::FromUInt64(_bytesPerSecond);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new UploadQueueStatusChanged(_queueDepth, _inFlightCount, _bytesPerSecond));
+	}
+};
+
+class UploadTableReconciled :
+	public CEvent
+{
+public:
+	UploadTableReconciled(const std::uint64_t& rowCount, const std::uint64_t& siaFileCount, const std::uint64_t& completedCount, const std::uint64_t& requeuedCount, const std::uint64_t& removedCount, const std::int64_t& elapsedMs) :
+		_rowCount(rowCount),
+		_siaFileCount(siaFileCount),
+		_completedCount(completedCount),
+		_requeuedCount(requeuedCount),
+		_removedCount(removedCount),
+		_elapsedMs(elapsedMs)
+	{
+
+	}
+
+public:
+	virtual ~UploadTableReconciled()
+	{
+	}
+
+private:
+	const std::uint64_t _rowCount;
+	const std::uint64_t _siaFileCount;
+	const std::uint64_t _completedCount;
+	const std::uint64_t _requeuedCount;
+	const std::uint64_t _removedCount;
+	const std::int64_t _elapsedMs;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"UploadTableReconciled|ROWS|" + SString::FromUInt64(_rowCount) + L"|SIA|" + SString::FromUInt64(_siaFileCount) + L"|COMPLETE|" + SString::FromUInt64(_completedCount) +
+			L"|REQUEUE|" + SString::FromUInt64(_requeuedCount) + L"|REMOVE|" + SString::FromUInt64(_removedCount) + L"|MS|" + SString::FromInt64(_elapsedMs);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new UploadTableReconciled(_rowCount, _siaFileCount, _completedCount, _requeuedCount, _removedCount, _elapsedMs));
+	}
+};
+
+class UploadStalled :
+	public CEvent
+{
+public:
+	UploadStalled(const SString& siaPath, const SString& filePath, const std::uint64_t& uploadedBytes, const std::uint64_t& fileSize) :
+		_siaPath(siaPath),
+		_filePath(filePath),
+		_uploadedBytes(uploadedBytes),
+		_fileSize(fileSize)
+	{
+
+	}
+
+public:
+	virtual ~UploadStalled()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const SString _filePath;
+	const std::uint64_t _uploadedBytes;
+	const std::uint64_t _fileSize;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"UploadStalled|SP|" + _siaPath + L"|FP|" + _filePath + L"|UP|" + SString::FromUInt64(_uploadedBytes) + L"|SZ|" + SString::FromUInt64(_fileSize);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new UploadStalled(_siaPath, _filePath, _uploadedBytes, _fileSize));
+	}
+};
+
+class UploadCoalesced :
+	public CEvent
+{
+public:
+	UploadCoalesced(const SString& siaPath, const SString& filePath, const std::uint64_t& avoidedUploadCount) :
+		CEvent(EventLevel::Debug),
+		_siaPath(siaPath),
+		_filePath(filePath),
+		_avoidedUploadCount(avoidedUploadCount)
+	{
+
+	}
+
+public:
+	virtual ~UploadCoalesced()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const SString _filePath;
+	const std::uint64_t _avoidedUploadCount;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"UploadCoalesced|SP|" + _siaPath + L"|FP|" + _filePath + L"|AVOIDED|" + SString::FromUInt64(_avoidedUploadCount);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new UploadCoalesced(_siaPath, _filePath, _avoidedUploadCount));
+	}
+};
+
+class UploadSkippedUnchanged :
+	public CEvent
+{
+public:
+	UploadSkippedUnchanged(const SString& siaPath, const SString& filePath, const std::uint64_t& bytesSaved) :
+		_siaPath(siaPath),
+		_filePath(filePath),
+		_bytesSaved(bytesSaved)
+	{
+
+	}
+
+public:
+	virtual ~UploadSkippedUnchanged()
+	{
+	}
+
+private:
+	const SString _siaPath;
+	const SString _filePath;
+	const std::uint64_t _bytesSaved;
+
+public:
+	virtual SString GetSingleLineMessage() const override
+	{
+		return L"UploadSkippedUnchanged|SP|" + _siaPath + L"|FP|" + _filePath + L"|SAVED|" + SString::FromUInt64(_bytesSaved);
+	}
+
+	virtual std::shared_ptr<CEvent> Clone() const override
+	{
+		return std::shared_ptr<CEvent>(new UploadSkippedUnchanged(_siaPath, _filePath, _bytesSaved));
+	}
+};
+
 class ExternallyRemovedFileDetected :
 	public CEvent
 {
@@ -54,6 +54,10 @@ public:
 	void Unmount(const bool& clearCache = false);
 
 	void ClearCache();
+
+	bool SetUploadFolderPriority(const SString& siaFolder, const std::int32_t& priority);
+
+	bool GetUploadProgress(std::uint64_t& activeCount, std::uint32_t& progress, std::uint64_t& bytesPerSecond, std::int64_t& etaSeconds) const;
 };
 
 
@@ -255,6 +255,7 @@ CSiaDriveApp::CSiaDriveApp()
   hostConfig.HostName = _siaDriveConfig->GetHostNameOrIp();
   hostConfig.HostPort = _siaDriveConfig->GetHostPort();
   hostConfig.RequiredVersion = COMPAT_SIAD_VERSION;
+  hostConfig.VersionCacheTtlSecs = _siaDriveConfig->GetVersionCacheTtlSecs();
   _siaCurl.reset(new CSiaCurl(hostConfig));
   _siaApi.reset(new CSiaApi(hostConfig, _siaDriveConfig.get()));
 }
@@ -433,9 +434,19 @@ void CSiaDriveApp::SiaApiRefreshCallback(CefRefPtr<CefV8Context> context, const
       ExecuteSetter(context, renterActions, "setUsedSpace", SiaCurrencyToGB(totalUsedGb));
 
       // Upload Progress
-      /*
-			SetRenterTotalUploadProgress(_siaApi->GetRenter()->GetTotalUploadProgress());
-      */
+      std::uint64_t activeCount = 0;
+      std::uint32_t progress = 100;
+      std::uint64_t bytesPerSecond = 0;
+      std::int64_t etaSeconds = 0;
+      if (_siaDrive && _siaDrive->GetUploadProgress(activeCount, progress, bytesPerSecond, etaSeconds))
+      {
+        auto uploadProgress = global->CreateObject(nullptr, nullptr);
+        uploadProgress->SetValue("ActiveCount", CefV8Value::CreateString(SString::FromUInt64(activeCount).str()), V8_PROPERTY_ATTRIBUTE_NONE);
+        uploadProgress->SetValue("Progress", CefV8Value::CreateString(SString::FromUInt32(progress).str()), V8_PROPERTY_ATTRIBUTE_NONE);
+        uploadProgress->SetValue("BytesPerSecond", CefV8Value::CreateString(SString::FromUInt64(bytesPerSecond).str()), V8_PROPERTY_ATTRIBUTE_NONE);
+        uploadProgress->SetValue("EtaSeconds", CefV8Value::CreateString(SString::FromInt64(etaSeconds).str()), V8_PROPERTY_ATTRIBUTE_NONE);
+        ExecuteSetter(context, renterActions, "setUploadProgress", uploadProgress);
+      }
 
       // Mount
       auto uiUpdate = global->GetValue("uiUpdate");
@@ -3,6 +3,10 @@
 
 using namespace Sia::Api;
 
+#define AUTO_THREAD_INTERVAL_MS 2000
+#define AUTO_THREAD_MIN_INTERVAL_MS 500
+#define AUTO_THREAD_MAX_INTERVAL_MS 30000
+
 CAutoThread::CAutoThread(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig) :
 	CAutoThread(siaCurl, siaDriveConfig, nullptr)
 {
@@ -11,9 +15,12 @@ CAutoThread::CAutoThread(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfi
 CAutoThread::CAutoThread(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, std::function<void(const CSiaCurl&, CSiaDriveConfig*)> autoThreadCallback) :
 	_siaCurl(new CSiaCurl(siaCurl)),
 	_siaDriveConfig(siaDriveConfig),
-#ifdef _WIN32
-	_stopEvent(::CreateEvent(nullptr, FALSE, FALSE, nullptr)),
-#endif
+	_stopRequested(false),
+	_wakeRequested(false),
+	_workReported(false),
+	_workPending(false),
+	_workActive(false),
+	_interval(AUTO_THREAD_INTERVAL_MS),
 	_AutoThreadCallback(autoThreadCallback)
 {
 }
@@ -21,9 +28,6 @@ CAutoThread::CAutoThread(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfi
 CAutoThread::~CAutoThread()
 {
 	StopAutoThread();
-#ifdef _WIN32
-	::CloseHandle(_stopEvent);
-#endif
 }
 
 SiaHostConfig CAutoThread::GetHostConfig() const
@@ -39,18 +43,65 @@ void CAutoThread::AutoThreadCallback(const CSiaCurl& siaCurl, CSiaDriveConfig* s
 	}
 }
 
+// Called from the callback - threads that report their workload poll quickly while work is pending
+//	and back off while idle. Work still in progress elsewhere (i.e. uploads in siad) caps the backoff at the
+//	default interval so its completion is noticed promptly. Others keep the fixed interval.
+void CAutoThread::SetWorkPending(const bool& workPending, const bool& workActive)
+{
+	std::lock_guard<std::mutex> l(_waitMutex);
+	_workReported = true;
+	_workPending = workPending;
+	_workActive = workActive;
+}
+
+std::chrono::milliseconds CAutoThread::GetNextInterval()
+{
+	if (_workReported)
+	{
+		const std::chrono::milliseconds::rep maxInterval = _workActive ? AUTO_THREAD_INTERVAL_MS : AUTO_THREAD_MAX_INTERVAL_MS;
+		_interval = _workPending ? std::chrono::milliseconds(AUTO_THREAD_MIN_INTERVAL_MS) : std::chrono::milliseconds((_interval.count() * 2 > maxInterval) ? maxInterval : _interval.count() * 2);
+		_workReported = false;
+	}
+	else
+	{
+		_interval = std::chrono::milliseconds(AUTO_THREAD_INTERVAL_MS);
+	}
+
+	return _interval;
+}
+
+// Runs the callback now instead of at the end of the current interval. A wake during the callback
+//	isn't lost - the next wait returns immediately.
+void CAutoThread::Wake()
+{
+	{
+		std::lock_guard<std::mutex> l(_waitMutex);
+		_wakeRequested = true;
+	}
+	_waitNotify.notify_all();
+}
+
 void CAutoThread::StartAutoThread()
 {
 	std::lock_guard<std::mutex> l(_startStopMutex);
 	if (!_thread)
 	{
+		{
+			std::lock_guard<std::mutex> l2(_waitMutex);
+			_stopRequested = false;
+		}
+
 		_thread.reset(new std::thread([this]() {
-#ifdef _WIN32
+			bool stopRequested = false;
 			do
 			{
 				AutoThreadCallback(*_siaCurl, _siaDriveConfig);
-			} while (::WaitForSingleObject(_stopEvent, 2000) == WAIT_TIMEOUT);
-#endif
+
+				std::unique_lock<std::mutex> l(_waitMutex);
+				_waitNotify.wait_for(l, GetNextInterval(), [this]() { return _stopRequested || _wakeRequested; });
+				_wakeRequested = false;
+				stopRequested = _stopRequested;
+			} while (!stopRequested);
 		}));
 	}
 }
@@ -60,9 +111,11 @@ void CAutoThread::StopAutoThread()
 	std::lock_guard<std::mutex> l(_startStopMutex);
 	if (_thread)
 	{
-#ifdef _WIN32
-		::SetEvent(_stopEvent);
-#endif
+		{
+			std::lock_guard<std::mutex> l2(_waitMutex);
+			_stopRequested = true;
+		}
+		_waitNotify.notify_all();
 		_thread->join();
 		_thread.reset(nullptr);
 	}
@@ -0,0 +1,252 @@
+#include <bandwidthpolicy.h>
+#include <ctime>
+
+using namespace Sia::Api;
+
+// Idle buckets accumulate at most this many seconds of transfer
+#define BUCKET_BURST_SECS 2
+// Whole-file transfers can overdraw the bucket - cap the debt so one large file can't stall the next for hours
+#define BUCKET_MAX_DEBT_SECS 60
+#define USAGE_WINDOW_SECS 60
+#define TOKEN_WAIT_INTERVAL_MS 100
+
+CBandwidthPolicy::CBandwidthPolicy()
+{
+	const auto now = std::chrono::steady_clock::now();
+	for (auto& bucket : _buckets)
+	{
+		bucket.BytesPerSecond = 0;
+		bucket.Tokens = 0;
+		bucket.LastRefill = now;
+		bucket.ReportedUsage = 0;
+	}
+}
+
+CBandwidthPolicy::~CBandwidthPolicy()
+{
+}
+
+SString CBandwidthPolicy::BandwidthDirectionToString(const _BandwidthDirection& direction)
+{
+	switch (direction)
+	{
+	case BandwidthDirection::Upload:
+		return L"Upload";
+
+	case BandwidthDirection::Download:
+		return L"Download";
+
+	default:
+		return L"!!Not Defined!!";
+	}
+}
+
+bool CBandwidthPolicy::ParseSchedule(const std::string& schedule, std::vector<WindowData>& windows)
+{
+	bool ret = true;
+	windows.clear();
+
+	std::size_t start = 0;
+	while (ret && (start < schedule.length()))
+	{
+		std::size_t end = schedule.find(';', start);
+		if (end == std::string::npos)
+		{
+			end = schedule.length();
+		}
+
+		const std::string entry = schedule.substr(start, end - start);
+		if (!entry.empty())
+		{
+			unsigned startHour, startMinute, endHour, endMinute, upload, download;
+			const int count = sscanf(entry.c_str(), "%u:%u-%u:%u=%u/%u", &startHour, &startMinute, &endHour, &endMinute, &upload, &download);
+			ret = ((count == 5) || (count == 6)) && (startHour < 24) && (startMinute < 60) && (endHour <= 24) && (endMinute < 60);
+			if (ret)
+			{
+				// Upload-only windows leave downloads unlimited
+				windows.push_back({ startHour * 60 + startMinute, endHour * 60 + endMinute, upload * 1024ull, (count == 6) ? download * 1024ull : 0 });
+			}
+		}
+
+		start = end + 1;
+	}
+
+	if (!ret)
+	{
+		windows.clear();
+	}
+
+	return ret;
+}
+
+std::uint32_t CBandwidthPolicy::GetLocalMinute()
+{
+	std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	const std::tm* local = std::localtime(&now);
+	return local->tm_hour * 60 + local->tm_min;
+}
+
+void CBandwidthPolicy::Refill(BucketData& bucket, const std::chrono::steady_clock::time_point& now)
+{
+	if (bucket.BytesPerSecond)
+	{
+		const double elapsed = std::chrono::duration<double>(now - bucket.LastRefill).count();
+		const double capacity = static_cast<double>(bucket.BytesPerSecond * BUCKET_BURST_SECS);
+		bucket.Tokens += elapsed * bucket.BytesPerSecond;
+		bucket.Tokens = (bucket.Tokens > capacity) ? capacity : bucket.Tokens;
+	}
+	bucket.LastRefill = now;
+}
+
+std::uint64_t CBandwidthPolicy::GetUsageLocked(BucketData& bucket, const std::chrono::steady_clock::time_point& now)
+{
+	while (!bucket.Usage.empty() && (now - bucket.Usage.front().first > std::chrono::seconds(USAGE_WINDOW_SECS)))
+	{
+		bucket.Usage.pop_front();
+	}
+
+	std::uint64_t windowBytes = 0;
+	for (const auto& usage : bucket.Usage)
+	{
+		windowBytes += usage.second;
+	}
+
+	return windowBytes / USAGE_WINDOW_SECS;
+}
+
+// Selects the limits in effect for the current time of day - call periodically so window boundaries are honored
+void CBandwidthPolicy::Update(CSiaDriveConfig* siaDriveConfig)
+{
+	std::lock_guard<std::mutex> l(_bucketMutex);
+	const std::string schedule = siaDriveConfig->GetBandwidthSchedule();
+	if (schedule != _schedule)
+	{
+		_schedule = schedule;
+		if (!ParseSchedule(schedule, _windows))
+		{
+			CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(BandwidthScheduleInvalid(schedule)));
+		}
+	}
+
+	std::uint64_t limits[2] = { siaDriveConfig->GetUploadLimitKBps() * 1024ull, siaDriveConfig->GetDownloadLimitKBps() * 1024ull };
+	const std::uint32_t minute = GetLocalMinute();
+	for (const auto& window : _windows)
+	{
+		// Windows ending before they start wrap past midnight
+		const bool active = (window.StartMinute <= window.EndMinute) ?
+			((minute >= window.StartMinute) && (minute < window.EndMinute)) :
+			((minute >= window.StartMinute) || (minute < window.EndMinute));
+		if (active)
+		{
+			limits[static_cast<unsigned>(BandwidthDirection::Upload)] = window.UploadBytesPerSecond;
+			limits[static_cast<unsigned>(BandwidthDirection::Download)] = window.DownloadBytesPerSecond;
+			break;
+		}
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < 2; i++)
+	{
+		BucketData& bucket = _buckets[i];
+		Refill(bucket, now);
+		if (bucket.BytesPerSecond != limits[i])
+		{
+			CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(BandwidthLimitChanged(static_cast<BandwidthDirection>(i), bucket.BytesPerSecond, limits[i])));
+			bucket.BytesPerSecond = limits[i];
+			bucket.Tokens = static_cast<double>(limits[i] * BUCKET_BURST_SECS);
+		}
+
+		const std::uint64_t usage = GetUsageLocked(bucket, now);
+		if (usage != bucket.ReportedUsage)
+		{
+			bucket.ReportedUsage = usage;
+			CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(BandwidthUsageChanged(static_cast<BandwidthDirection>(i), usage, bucket.BytesPerSecond)));
+		}
+	}
+	_bucketNotify.notify_all();
+}
+
+// Bytes per second, 0 for unlimited
+std::uint64_t CBandwidthPolicy::GetLimit(const _BandwidthDirection& direction)
+{
+	std::lock_guard<std::mutex> l(_bucketMutex);
+	return _buckets[static_cast<unsigned>(direction)].BytesPerSecond;
+}
+
+std::uint64_t CBandwidthPolicy::GetUsage(const _BandwidthDirection& direction)
+{
+	std::lock_guard<std::mutex> l(_bucketMutex);
+	return GetUsageLocked(_buckets[static_cast<unsigned>(direction)], std::chrono::steady_clock::now());
+}
+
+bool CBandwidthPolicy::TryAcquire(const _BandwidthDirection& direction)
+{
+	std::lock_guard<std::mutex> l(_bucketMutex);
+	BucketData& bucket = _buckets[static_cast<unsigned>(direction)];
+	Refill(bucket, std::chrono::steady_clock::now());
+	return !bucket.BytesPerSecond || (bucket.Tokens > 0);
+}
+
+// Returns false if the bucket is still overdrawn after 'timeoutMs' - callers proceed regardless rather than fail
+bool CBandwidthPolicy::WaitForTokens(const _BandwidthDirection& direction, const std::uint32_t& timeoutMs)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	std::unique_lock<std::mutex> l(_bucketMutex);
+	BucketData& bucket = _buckets[static_cast<unsigned>(direction)];
+	Refill(bucket, std::chrono::steady_clock::now());
+	while (bucket.BytesPerSecond && (bucket.Tokens <= 0) && (std::chrono::steady_clock::now() < deadline))
+	{
+		_bucketNotify.wait_for(l, std::chrono::milliseconds(TOKEN_WAIT_INTERVAL_MS));
+		Refill(bucket, std::chrono::steady_clock::now());
+	}
+
+	return !bucket.BytesPerSecond || (bucket.Tokens > 0);
+}
+
+// Charges observed transfer against the bucket. Usage is tracked even when unlimited.
+void CBandwidthPolicy::Consume(const _BandwidthDirection& direction, const std::uint64_t& bytes)
+{
+	if (bytes)
+	{
+		std::lock_guard<std::mutex> l(_bucketMutex);
+		BucketData& bucket = _buckets[static_cast<unsigned>(direction)];
+		const auto now = std::chrono::steady_clock::now();
+		Refill(bucket, now);
+		bucket.Usage.push_back({ now, bytes });
+		if (bucket.BytesPerSecond)
+		{
+			const double maxDebt = static_cast<double>(bucket.BytesPerSecond * BUCKET_MAX_DEBT_SECS);
+			bucket.Tokens -= static_cast<double>(bytes);
+			bucket.Tokens = (bucket.Tokens < -maxDebt) ? -maxDebt : bucket.Tokens;
+		}
+	}
+}
+
+// Number of concurrent transfers that fit the limit, estimated from the observed rate of those active.
+//	Without an estimate, concurrency ramps up one transfer at a time.
+std::uint64_t CBandwidthPolicy::GetAdmissionCount(const _BandwidthDirection& direction, const std::uint64_t& activeCount, const std::uint64_t& maxCount)
+{
+	std::lock_guard<std::mutex> l(_bucketMutex);
+	BucketData& bucket = _buckets[static_cast<unsigned>(direction)];
+	const auto now = std::chrono::steady_clock::now();
+	Refill(bucket, now);
+
+	std::uint64_t ret = maxCount;
+	if (bucket.BytesPerSecond)
+	{
+		if (bucket.Tokens <= 0)
+		{
+			ret = activeCount;
+		}
+		else
+		{
+			const std::uint64_t usage = GetUsageLocked(bucket, now);
+			const std::uint64_t perTransfer = activeCount ? usage / activeCount : 0;
+			ret = perTransfer ? bucket.BytesPerSecond / perTransfer : activeCount + 1;
+			ret = ret ? ret : 1;
+		}
+		ret = (ret > maxCount) ? maxCount : ret;
+	}
+
+	return ret;
+}
@@ -1,5 +1,4 @@
 #include <filepath.h>
-#include <regex>
 #ifdef _WIN32
 #include <Shlobj.h>
 #endif
@@ -8,15 +7,36 @@ using namespace Sia::Api;
 SString FilePath::FinalizePath(const SString& path)
 {
 #ifdef _WIN32
-  std::wregex r(L"/+");
-  SString str = std::regex_replace(path.str(), r, L"\\");
-  std::wregex r2(L"\\\\+");
-  return std::regex_replace(str.str(), r2, L"\\");
+  return NormalizeSeparators(path, '\\');
 #else
   a
 #endif
 }
 
+// Converts '/' and '\\' to the requested separator, collapsing runs of mixed separators into one
+SString FilePath::NormalizeSeparators(const SString& path, const SString::SChar& separator)
+{
+  const SString::String& str = path.str();
+  SString::String ret;
+  ret.reserve(str.length());
+  for (const auto& c : str)
+  {
+    if ((c == '/') || (c == '\\'))
+    {
+      if (ret.empty() || (ret.back() != separator))
+      {
+        ret.push_back(separator);
+      }
+    }
+    else
+    {
+      ret.push_back(c);
+    }
+  }
+
+  return ret;
+}
+
 SString FilePath::GetTempDirectory()
 {
 #ifdef _WIN32
@@ -0,0 +1,123 @@
+#include <globmatcher.h>
+
+using namespace Sia::Api;
+
+#define MAX_CACHED_GLOB_MATCHERS 256
+
+CGlobMatcher::CGlobMatcher(const SString& pattern) :
+	_pattern(pattern.str()),
+	_hasWildcards(false)
+{
+	for (size_t i = 0; i < _pattern.length(); i++)
+	{
+		const SString::SChar c = _pattern[i];
+		if (c == '*')
+		{
+			// Consecutive stars behave as one
+			if (_tokens.empty() || (_tokens.back().Type != _TokenType::Star))
+			{
+				_tokens.push_back({ _TokenType::Star, i, 1 });
+			}
+			_hasWildcards = true;
+		}
+		else if (c == '?')
+		{
+			_tokens.push_back({ _TokenType::Question, i, 1 });
+			_hasWildcards = true;
+		}
+		else if (!_tokens.empty() && (_tokens.back().Type == _TokenType::Literal))
+		{
+			_tokens.back().Length++;
+		}
+		else
+		{
+			_tokens.push_back({ _TokenType::Literal, i, 1 });
+		}
+	}
+}
+
+CGlobMatcher::~CGlobMatcher()
+{
+}
+
+std::shared_ptr<const CGlobMatcher> CGlobMatcher::Get(const SString& pattern)
+{
+	static std::mutex cacheMutex;
+	static std::unordered_map<SString, std::shared_ptr<const CGlobMatcher>> cache;
+
+	std::lock_guard<std::mutex> l(cacheMutex);
+	auto it = cache.find(pattern);
+	if (it != cache.end())
+	{
+		return it->second;
+	}
+
+	// Directory listings produce an unbounded set of patterns over time - start over rather than track usage
+	if (cache.size() >= MAX_CACHED_GLOB_MATCHERS)
+	{
+		cache.clear();
+	}
+
+	auto matcher = std::make_shared<const CGlobMatcher>(pattern);
+	cache.insert({ pattern, matcher });
+	return matcher;
+}
+
+bool CGlobMatcher::MatchTokens(const size_t& tokenIdx, const SString::SChar* text, const size_t& textLength) const
+{
+	if (tokenIdx == _tokens.size())
+	{
+		return (textLength == 0);
+	}
+
+	const _Token& token = _tokens[tokenIdx];
+	switch (token.Type)
+	{
+	case _TokenType::Literal:
+	{
+		return (textLength >= token.Length) &&
+			(_pattern.compare(token.Offset, token.Length, text, token.Length) == 0) &&
+			MatchTokens(tokenIdx + 1, text + token.Length, textLength - token.Length);
+	}
+
+	case _TokenType::Question:
+	{
+		if ((textLength > 0) && (text[0] != '/') && MatchTokens(tokenIdx + 1, text + 1, textLength - 1))
+		{
+			return true;
+		}
+		return MatchTokens(tokenIdx + 1, text, textLength);
+	}
+
+	case _TokenType::Star:
+	{
+		// Shortest segment first; a star never crosses '/'
+		for (size_t i = 1; (i <= textLength) && (text[i - 1] != '/'); i++)
+		{
+			if (MatchTokens(tokenIdx + 1, text + i, textLength - i))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	}
+
+	return false;
+}
+
+bool CGlobMatcher::HasWildcards() const
+{
+	return _hasWildcards;
+}
+
+bool CGlobMatcher::IsMatch(const SString& path) const
+{
+	const SString::String& text = path.str();
+	if (!_hasWildcards)
+	{
+		return (text == _pattern);
+	}
+
+	return MatchTokens(0, text.c_str(), text.length());
+}
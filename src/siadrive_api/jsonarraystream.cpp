@@ -0,0 +1,210 @@
+#include <jsonarraystream.h>
+
+using namespace Sia::Api;
+
+CJsonArrayStream::CJsonArrayStream(const std::string& arrayName, std::function<void(const json&)> elementCallback) :
+	_arrayName(arrayName),
+	_elementCallback(elementCallback),
+	_depth(0),
+	_inString(false),
+	_escape(false),
+	_keyCapture(false),
+	_arrayActive(false),
+	_capturing(false),
+	_scalarElement(false),
+	_complete(false),
+	_error(false),
+	_ElementCount(0)
+{
+}
+
+CJsonArrayStream::~CJsonArrayStream()
+{
+}
+
+void CJsonArrayStream::EmitElement()
+{
+	try
+	{
+		if (_rawElementCallback)
+		{
+			_rawElementCallback(_element);
+		}
+		else
+		{
+			_elementCallback(json::parse(_element.c_str()));
+		}
+		SetElementCount(GetElementCount() + 1);
+	}
+	catch (...)
+	{
+		_error = true;
+	}
+
+	_capturing = false;
+	_element.clear();
+}
+
+void CJsonArrayStream::ProcessChar(const char& c)
+{
+	if (_inString)
+	{
+		if (_capturing)
+		{
+			_element += c;
+		}
+
+		if (_escape)
+		{
+			_escape = false;
+			if (_keyCapture)
+			{
+				_key += c;
+			}
+		}
+		else if (c == '\\')
+		{
+			_escape = true;
+			if (_keyCapture)
+			{
+				_key += c;
+			}
+		}
+		else if (c == '"')
+		{
+			_inString = false;
+			if (_keyCapture)
+			{
+				_keyCapture = false;
+				_lastKey = _key;
+			}
+		}
+		else if (_keyCapture)
+		{
+			_key += c;
+		}
+
+		return;
+	}
+
+	const bool isSpace = ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+	if (_complete)
+	{
+		_error = !isSpace;
+		return;
+	}
+
+	// Scalar elements have no closing token - they end at the next separator
+	if (_capturing && _scalarElement && ((c == ',') || (c == ']') || isSpace))
+	{
+		EmitElement();
+	}
+
+	if (_arrayActive && (_depth == 2) && !_capturing)
+	{
+		if (isSpace || (c == ','))
+		{
+			return;
+		}
+
+		if (c == ']')
+		{
+			_arrayActive = false;
+			_depth--;
+			return;
+		}
+
+		_capturing = true;
+		_scalarElement = ((c != '{') && (c != '['));
+		_element.clear();
+	}
+
+	if (_capturing)
+	{
+		_element += c;
+	}
+
+	switch (c)
+	{
+	case '"':
+	{
+		_inString = true;
+		if ((_depth == 1) && !_capturing)
+		{
+			_keyCapture = true;
+			_key.clear();
+		}
+	}
+	break;
+
+	case '{':
+	case '[':
+	{
+		if ((_depth == 0) && (c != '{'))
+		{
+			_error = true;
+		}
+		else if ((_depth == 1) && (c == '[') && (_lastKey == _arrayName))
+		{
+			_arrayActive = true;
+		}
+		_depth++;
+	}
+	break;
+
+	case '}':
+	case ']':
+	{
+		if (_depth == 0)
+		{
+			_error = true;
+		}
+		else
+		{
+			_depth--;
+			_complete = (_depth == 0);
+			if (_capturing && !_scalarElement && (_depth == 2))
+			{
+				EmitElement();
+			}
+		}
+	}
+	break;
+
+	default:
+	{
+		if ((_depth == 0) && !isSpace)
+		{
+			_error = true;
+		}
+	}
+	break;
+	}
+}
+
+bool CJsonArrayStream::Feed(const char* buffer, const size_t& length)
+{
+	for (size_t i = 0; !_error && (i < length); i++)
+	{
+		ProcessChar(buffer[i]);
+	}
+
+	return !_error;
+}
+
+bool CJsonArrayStream::IsComplete() const
+{
+	return _complete && !_error;
+}
+
+bool CJsonArrayStream::HasError() const
+{
+	return _error;
+}
+
+// Hands each element's unparsed text to the callback instead of parsing it here - the callback may take
+//	ownership of the buffer
+void CJsonArrayStream::SetRawElementCallback(std::function<void(std::string&)> rawElementCallback)
+{
+	_rawElementCallback = rawElementCallback;
+}
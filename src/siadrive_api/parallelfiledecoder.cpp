@@ -0,0 +1,169 @@
+#include <parallelfiledecoder.h>
+
+using namespace Sia::Api;
+
+#define FILE_DECODE_BATCH_SIZE 4096
+#define MAX_FILE_DECODE_WORKERS 8
+
+CParallelFileDecoder::CParallelFileDecoder() :
+	CParallelFileDecoder(GetDefaultWorkerCount())
+{
+}
+
+CParallelFileDecoder::CParallelFileDecoder(const int& workerCount) :
+	_workerCount((workerCount < 1) ? 1 : workerCount),
+	_finished(false),
+	_error(false)
+{
+}
+
+CParallelFileDecoder::~CParallelFileDecoder()
+{
+	StopWorkers();
+}
+
+int CParallelFileDecoder::GetDefaultWorkerCount()
+{
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+	return (cores < 1) ? 1 : ((cores > MAX_FILE_DECODE_WORKERS) ? MAX_FILE_DECODE_WORKERS : cores);
+}
+
+bool CParallelFileDecoder::DecodeBatch(const Batch& batch, std::vector<DecodedFile>& decoded)
+{
+	try
+	{
+		decoded.reserve(batch.size());
+		for (const auto& element : batch)
+		{
+			const json file = json::parse(element.c_str());
+			decoded.push_back({
+				file["siapath"].get<std::string>(),
+				file["filesize"].get<std::uint64_t>(),
+				file["available"].get<bool>(),
+				file["renewing"].get<bool>(),
+				file["redundancy"].get<std::uint32_t>(),
+				file["uploadprogress"].get<std::uint32_t>(),
+				file["expiration"].get<std::uint32_t>() });
+		}
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+void CParallelFileDecoder::StoreResult(const std::size_t& sequence, std::vector<DecodedFile>& decoded, const bool& success)
+{
+	std::lock_guard<std::mutex> l(_mutex);
+	_results[sequence] = std::move(decoded);
+	_error = _error || !success;
+}
+
+void CParallelFileDecoder::Worker()
+{
+	std::unique_lock<std::mutex> l(_mutex);
+	while (true)
+	{
+		_notify.wait(l, [this]() { return _finished || !_pending.empty(); });
+		if (_pending.empty())
+		{
+			break;
+		}
+
+		auto work = std::move(_pending.front());
+		_pending.pop_front();
+		l.unlock();
+
+		std::vector<DecodedFile> decoded;
+		const bool success = DecodeBatch(work.second, decoded);
+		StoreResult(work.first, decoded, success);
+
+		l.lock();
+	}
+}
+
+void CParallelFileDecoder::SubmitBatch()
+{
+	Batch batch;
+	batch.swap(_batch);
+
+	std::size_t sequence;
+	{
+		std::lock_guard<std::mutex> l(_mutex);
+		sequence = _results.size();
+		_results.emplace_back();
+	}
+
+	if (_workers.empty() && (_finished || (_workerCount == 1)))
+	{
+		std::vector<DecodedFile> decoded;
+		const bool success = DecodeBatch(batch, decoded);
+		StoreResult(sequence, decoded, success);
+	}
+	else
+	{
+		while (static_cast<int>(_workers.size()) < _workerCount)
+		{
+			_workers.emplace_back([this]() { Worker(); });
+		}
+
+		{
+			std::lock_guard<std::mutex> l(_mutex);
+			_pending.push_back({ sequence, std::move(batch) });
+		}
+		_notify.notify_one();
+	}
+}
+
+void CParallelFileDecoder::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> l(_mutex);
+		_finished = true;
+	}
+	_notify.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+	_workers.clear();
+}
+
+void CParallelFileDecoder::Push(std::string& element)
+{
+	_batch.push_back(std::move(element));
+	if (_batch.size() == FILE_DECODE_BATCH_SIZE)
+	{
+		SubmitBatch();
+	}
+}
+
+bool CParallelFileDecoder::Finish(CSiaFileStore& fileStore)
+{
+	{
+		std::lock_guard<std::mutex> l(_mutex);
+		_finished = true;
+	}
+
+	if (!_batch.empty())
+	{
+		SubmitBatch();
+	}
+	StopWorkers();
+
+	if (!_error)
+	{
+		for (auto& decoded : _results)
+		{
+			for (const auto& file : decoded)
+			{
+				fileStore.Add(file.SiaPath, file.FileSize, file.Available, file.Renewing, file.Redundancy, file.UploadProgress, file.Expiration);
+			}
+			std::vector<DecodedFile>().swap(decoded);
+		}
+	}
+
+	return !_error;
+}
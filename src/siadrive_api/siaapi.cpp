@@ -1,6 +1,6 @@
 #include <siaapi.h>
-#include <regex>
 #include <siadriveconfig.h>
+#include <filepath.h>
 
 using namespace Sia::Api;
 
@@ -13,6 +13,11 @@ CSiaApi::CSiaApi(const SiaHostConfig& hostConfig, CSiaDriveConfig* siaDriveConfi
 	_consensus(new CSiaConsensus(_siaCurl, siaDriveConfig)),
   _refreshThread(new CAutoThread(_siaCurl, _siaDriveConfig, [this] (const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig) { this->Refresh(siaCurl, siaDriveConfig); }))
 {
+	// Balanced by Shutdown() in the destructor - the engine and pool are otherwise created on first use
+	CSiaCurl::Startup();
+
+  // Listings are available immediately from the last snapshot, reconciled by the first refresh
+  _renter->LoadFileTreeSnapshot();
   _refreshThread->StartAutoThread();
 }
 
@@ -21,6 +26,9 @@ CSiaApi::~CSiaApi()
   _refreshThread->StopAutoThread();
 	//TODO Make this an option to lock on exit
 	//_wallet->Lock();
+
+	// Shared curl state is torn down here rather than at DLL detach
+	CSiaCurl::Shutdown();
 }
 
 void CSiaApi::Refresh(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig)
@@ -34,11 +42,8 @@ SString CSiaApi::FormatToSiaPath(SString path)
 {
 	if (path.Length())
 	{
-		std::replace(path.begin(), path.end(), '\\', '/');
-		std::wregex r(L"/+");
-		path = std::regex_replace(path.str(), r, L"/");
-
-		while (path[0] == '/')
+		path = FilePath::NormalizeSeparators(path, '/');
+		if (path.Length() && (path[0] == '/'))
 		{
 			path = path.SubString(1);
 		}
@@ -71,6 +71,181 @@ SString GenerateSha256(const SString& str)
 #endif
 }
 
+#define XXH_PRIME64_1 11400714785074694791ULL
+#define XXH_PRIME64_2 14029467366897019727ULL
+#define XXH_PRIME64_3 1609587929392839161ULL
+#define XXH_PRIME64_4 9650029242287828579ULL
+#define XXH_PRIME64_5 2870177450012600261ULL
+
+static inline std::uint64_t XXH64Rotl(const std::uint64_t& value, const int& bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline std::uint64_t XXH64Read64(const unsigned char* data)
+{
+	std::uint64_t ret;
+	memcpy(&ret, data, sizeof(ret));
+	return ret;
+}
+
+static inline std::uint32_t XXH64Read32(const unsigned char* data)
+{
+	std::uint32_t ret;
+	memcpy(&ret, data, sizeof(ret));
+	return ret;
+}
+
+static inline std::uint64_t XXH64Round(std::uint64_t acc, const std::uint64_t& input)
+{
+	acc += input * XXH_PRIME64_2;
+	return XXH64Rotl(acc, 31) * XXH_PRIME64_1;
+}
+
+static inline std::uint64_t XXH64MergeRound(std::uint64_t acc, const std::uint64_t& value)
+{
+	acc ^= XXH64Round(0, value);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// Streaming xxHash64 (seed 0) - input is consumed in 32 byte stripes, with the tail held until Finish()
+class CXXHash64
+{
+public:
+	CXXHash64() :
+		_totalLength(0),
+		_tailLength(0)
+	{
+		_accumulators[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+		_accumulators[1] = XXH_PRIME64_2;
+		_accumulators[2] = 0;
+		_accumulators[3] = 0 - XXH_PRIME64_1;
+	}
+
+private:
+	std::uint64_t _accumulators[4];
+	std::uint64_t _totalLength;
+	unsigned char _tail[32];
+	std::size_t _tailLength;
+
+private:
+	void ProcessStripe(const unsigned char* data)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			_accumulators[i] = XXH64Round(_accumulators[i], XXH64Read64(data + i * 8));
+		}
+	}
+
+public:
+	void Update(const unsigned char* data, std::size_t length)
+	{
+		_totalLength += length;
+		if (_tailLength)
+		{
+			const std::size_t fill = ((32 - _tailLength) < length) ? 32 - _tailLength : length;
+			memcpy(_tail + _tailLength, data, fill);
+			_tailLength += fill;
+			data += fill;
+			length -= fill;
+			if (_tailLength < 32)
+			{
+				return;
+			}
+			ProcessStripe(_tail);
+			_tailLength = 0;
+		}
+
+		for (; length >= 32; data += 32, length -= 32)
+		{
+			ProcessStripe(data);
+		}
+
+		memcpy(_tail, data, length);
+		_tailLength = length;
+	}
+
+	std::uint64_t Finish() const
+	{
+		std::uint64_t ret;
+		if (_totalLength >= 32)
+		{
+			ret = XXH64Rotl(_accumulators[0], 1) + XXH64Rotl(_accumulators[1], 7) + XXH64Rotl(_accumulators[2], 12) + XXH64Rotl(_accumulators[3], 18);
+			for (int i = 0; i < 4; i++)
+			{
+				ret = XXH64MergeRound(ret, _accumulators[i]);
+			}
+		}
+		else
+		{
+			ret = XXH_PRIME64_5;
+		}
+		ret += _totalLength;
+
+		const unsigned char* data = _tail;
+		std::size_t length = _tailLength;
+		for (; length >= 8; data += 8, length -= 8)
+		{
+			ret ^= XXH64Round(0, XXH64Read64(data));
+			ret = XXH64Rotl(ret, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		}
+
+		if (length >= 4)
+		{
+			ret ^= static_cast<std::uint64_t>(XXH64Read32(data)) * XXH_PRIME64_1;
+			ret = XXH64Rotl(ret, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+			data += 4;
+			length -= 4;
+		}
+
+		for (; length; data++, length--)
+		{
+			ret ^= (*data) * XXH_PRIME64_5;
+			ret = XXH64Rotl(ret, 11) * XXH_PRIME64_1;
+		}
+
+		ret ^= ret >> 33;
+		ret *= XXH_PRIME64_2;
+		ret ^= ret >> 29;
+		ret *= XXH_PRIME64_3;
+		ret ^= ret >> 32;
+
+		return ret;
+	}
+};
+
+// Streams the file contents through xxHash64 - returns an empty string if the file can't be read
+SString GenerateFileHash(const SString& filePath)
+{
+#ifdef _WIN32
+	SString ret;
+	HANDLE file = ::CreateFile(filePath.str().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CXXHash64 hash;
+		std::vector<unsigned char> buffer(1024 * 1024);
+		DWORD bytesRead = 0;
+		BOOL ok;
+		while ((ok = ::ReadFile(file, &buffer[0], static_cast<DWORD>(buffer.size()), &bytesRead, nullptr)) && bytesRead)
+		{
+			hash.Update(&buffer[0], bytesRead);
+		}
+		::CloseHandle(file);
+
+		if (ok)
+		{
+			std::ostringstream ss;
+			ss << std::hex << std::uppercase << std::setfill('0') << std::setw(16) << hash.Finish();
+			ret = ss.str();
+		}
+	}
+
+	return ret;
+#else
+  a
+#endif
+}
+
 BOOL RecurDeleteFilesByExtentsion(const SString& folder, const SString& extensionWithDot)
 {
 #ifdef _WIN32
@@ -1,11 +1,478 @@
 #include <siacurl.h>
 #include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 
 using namespace Sia::Api;
 
+#define MAX_IDLE_CURL_HANDLES 16
+
+class CCurlHandlePool;
+class CCurlMultiEngine;
+
+// The engine and pool are created on first use and destroyed by CSiaCurl::Shutdown() from CSiaApi's lifetime -
+//	never by static destructors, which run under the loader lock when the DLL detaches
+static std::mutex CurlLifetimeMutex;
+static std::uint32_t CurlStartupCount = 0;
+static std::atomic<CCurlHandlePool*> CurlHandlePool(nullptr);
+static std::atomic<CCurlMultiEngine*> CurlMultiEngine(nullptr);
+
+// Process-wide pool of curl easy handles. Idle handles retain their live keep-alive connections
+//	so repeated siad requests from the refresh, upload and file-list threads avoid a TCP connect/teardown
+//	per call. All handles are attached to a single share handle for DNS (and connection) caching.
+class CCurlHandlePool
+{
+public:
+	CCurlHandlePool() :
+		_shareHandle(nullptr),
+		_poolHits(0),
+		_poolMisses(0)
+	{
+		curl_global_init(CURL_GLOBAL_ALL);
+
+		_shareHandle = curl_share_init();
+		curl_share_setopt(_shareHandle, CURLSHOPT_LOCKFUNC, static_cast<void(*)(CURL*, curl_lock_data, curl_lock_access, void*)>([](CURL*, curl_lock_data data, curl_lock_access, void* userPtr)
+		{
+			reinterpret_cast<CCurlHandlePool*>(userPtr)->_shareMutex[data].lock();
+		}));
+		curl_share_setopt(_shareHandle, CURLSHOPT_UNLOCKFUNC, static_cast<void(*)(CURL*, curl_lock_data, void*)>([](CURL*, curl_lock_data data, void* userPtr)
+		{
+			reinterpret_cast<CCurlHandlePool*>(userPtr)->_shareMutex[data].unlock();
+		}));
+		curl_share_setopt(_shareHandle, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(_shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x073900
+		// Connection cache sharing requires curl 7.57.0 or above
+		curl_share_setopt(_shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+	}
+
+	~CCurlHandlePool()
+	{
+		for (auto* curlHandle : _idleHandles)
+		{
+			curl_easy_cleanup(curlHandle);
+		}
+		_idleHandles.clear();
+
+		curl_share_cleanup(_shareHandle);
+		curl_global_cleanup();
+	}
+
+private:
+	CURLSH* _shareHandle;
+	std::mutex _shareMutex[CURL_LOCK_DATA_LAST];
+	std::mutex _poolMutex;
+	std::deque<CURL*> _idleHandles;
+	std::atomic<std::uint64_t> _poolHits;
+	std::atomic<std::uint64_t> _poolMisses;
+
+public:
+	static CCurlHandlePool& Instance()
+	{
+		CCurlHandlePool* curlHandlePool = CurlHandlePool;
+		if (!curlHandlePool)
+		{
+			std::lock_guard<std::mutex> l(CurlLifetimeMutex);
+			curlHandlePool = CurlHandlePool;
+			if (!curlHandlePool)
+			{
+				curlHandlePool = new CCurlHandlePool();
+				CurlHandlePool = curlHandlePool;
+			}
+		}
+
+		return *curlHandlePool;
+	}
+
+public:
+	CURL* Acquire()
+	{
+		CURL* curlHandle = nullptr;
+		{
+			std::lock_guard<std::mutex> l(_poolMutex);
+			if (_idleHandles.size())
+			{
+				curlHandle = _idleHandles.back();
+				_idleHandles.pop_back();
+			}
+		}
+
+		if (curlHandle)
+		{
+			// Reset clears options only - live connections and caches are retained
+			curl_easy_reset(curlHandle);
+			_poolHits++;
+		}
+		else
+		{
+			curlHandle = curl_easy_init();
+			_poolMisses++;
+		}
+
+		curl_easy_setopt(curlHandle, CURLOPT_SHARE, _shareHandle);
+		curl_easy_setopt(curlHandle, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+		curl_easy_setopt(curlHandle, CURLOPT_USERAGENT, "Sia-Agent");
+
+		return curlHandle;
+	}
+
+	void Release(CURL* curlHandle)
+	{
+		if (curlHandle)
+		{
+			std::lock_guard<std::mutex> l(_poolMutex);
+			if (_idleHandles.size() < MAX_IDLE_CURL_HANDLES)
+			{
+				_idleHandles.push_back(curlHandle);
+				curlHandle = nullptr;
+			}
+		}
+
+		if (curlHandle)
+		{
+			curl_easy_cleanup(curlHandle);
+		}
+	}
+
+	std::uint64_t GetPoolHits() const
+	{
+		return _poolHits;
+	}
+
+	std::uint64_t GetPoolMisses() const
+	{
+		return _poolMisses;
+	}
+};
+
+// Process-wide cache of siad versions verified per host. An entry is dropped once a request to that
+//	host fails to connect (new connection epoch) or once its TTL has elapsed.
+class CVersionCache
+{
+private:
+	typedef struct
+	{
+		SString ServerVersion;
+		std::chrono::steady_clock::time_point VerifiedAt;
+	} VersionEntry;
+
+public:
+	CVersionCache() :
+		_cacheHits(0),
+		_validations(0)
+	{
+	}
+
+private:
+	std::mutex _cacheMutex;
+	std::unordered_map<SString, VersionEntry> _versionMap;
+	std::atomic<std::uint64_t> _cacheHits;
+	std::atomic<std::uint64_t> _validations;
+
+public:
+	static CVersionCache& Instance()
+	{
+		static CVersionCache versionCache;
+		return versionCache;
+	}
+
+	static SString CreateHostKey(const SiaHostConfig& hostConfig)
+	{
+		return hostConfig.HostName + ":" + SString::FromUInt32(hostConfig.HostPort);
+	}
+
+public:
+	bool Find(const SiaHostConfig& hostConfig, SString& serverVersion)
+	{
+		bool ret = false;
+		{
+			std::lock_guard<std::mutex> l(_cacheMutex);
+			auto it = _versionMap.find(CreateHostKey(hostConfig));
+			if (it != _versionMap.end())
+			{
+				if (hostConfig.VersionCacheTtlSecs && ((std::chrono::steady_clock::now() - it->second.VerifiedAt) < std::chrono::seconds(hostConfig.VersionCacheTtlSecs)))
+				{
+					serverVersion = it->second.ServerVersion;
+					ret = true;
+				}
+				else
+				{
+					_versionMap.erase(it);
+				}
+			}
+		}
+
+		if (ret)
+		{
+			_cacheHits++;
+		}
+
+		return ret;
+	}
+
+	void Update(const SiaHostConfig& hostConfig, const SString& serverVersion)
+	{
+		_validations++;
+		std::lock_guard<std::mutex> l(_cacheMutex);
+		_versionMap[CreateHostKey(hostConfig)] = { serverVersion, std::chrono::steady_clock::now() };
+	}
+
+	void Invalidate(const SiaHostConfig& hostConfig)
+	{
+		std::lock_guard<std::mutex> l(_cacheMutex);
+		_versionMap.erase(CreateHostKey(hostConfig));
+	}
+
+	std::uint64_t GetCacheHits() const
+	{
+		return _cacheHits;
+	}
+
+	std::uint64_t GetValidations() const
+	{
+		return _validations;
+	}
+};
+
+// Scoped pool handle
+class CPooledCurlHandle
+{
+public:
+	CPooledCurlHandle() :
+		_curlHandle(CCurlHandlePool::Instance().Acquire())
+	{
+	}
+
+	~CPooledCurlHandle()
+	{
+		CCurlHandlePool::Instance().Release(_curlHandle);
+	}
+
+public:
+	CPooledCurlHandle(const CPooledCurlHandle&) = delete;
+	CPooledCurlHandle& operator=(const CPooledCurlHandle&) = delete;
+
+private:
+	CURL* _curlHandle;
+
+public:
+	operator CURL*() const { return _curlHandle; }
+};
+
+// Single event-loop thread driving all asynchronous siad requests through one curl multi handle
+class CCurlMultiEngine
+{
+public:
+	typedef std::function<void(const CURLcode&, const long&, const std::string&)> CompletionCallback;
+
+private:
+	typedef struct
+	{
+		CURL* CurlHandle;
+		std::string Url;
+		std::string PostFields;
+		bool IsPost;
+		std::string Result;
+		CompletionCallback Completion;
+	} AsyncRequest;
+
+public:
+	CCurlMultiEngine() :
+		_multiHandle(nullptr),
+		_stopRequested(false)
+	{
+	}
+
+	~CCurlMultiEngine()
+	{
+		{
+			std::lock_guard<std::mutex> l(_queueMutex);
+			_stopRequested = true;
+		}
+		_queueNotify.notify_all();
+
+		if (_thread)
+		{
+			_thread->join();
+			_thread.reset(nullptr);
+		}
+	}
+
+private:
+	CURLM* _multiHandle;
+	bool _stopRequested;
+	std::mutex _queueMutex;
+	std::condition_variable _queueNotify;
+	std::deque<std::unique_ptr<AsyncRequest>> _pendingRequests;
+	std::unordered_map<CURL*, std::unique_ptr<AsyncRequest>> _activeRequests;
+	std::unique_ptr<std::thread> _thread;
+
+public:
+	static CCurlMultiEngine& Instance()
+	{
+		CCurlMultiEngine* curlMultiEngine = CurlMultiEngine;
+		if (!curlMultiEngine)
+		{
+			std::lock_guard<std::mutex> l(CurlLifetimeMutex);
+			curlMultiEngine = CurlMultiEngine;
+			if (!curlMultiEngine)
+			{
+				curlMultiEngine = new CCurlMultiEngine();
+				CurlMultiEngine = curlMultiEngine;
+			}
+		}
+
+		return *curlMultiEngine;
+	}
+
+private:
+	static void CompleteRequest(AsyncRequest& request, const CURLcode& res, const long& httpCode)
+	{
+		try
+		{
+			request.Completion(res, httpCode, request.Result);
+		}
+		catch (...)
+		{
+			// Completion callbacks must not terminate the event loop
+		}
+	}
+
+	void StartRequest(std::unique_ptr<AsyncRequest> request)
+	{
+		CURL* curlHandle = request->CurlHandle;
+		curl_easy_setopt(curlHandle, CURLOPT_URL, request->Url.c_str());
+		if (request->IsPost)
+		{
+			curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, request->PostFields.c_str());
+		}
+		curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, static_cast<size_t(*)(char*, size_t, size_t, void *)>([](char *buffer, size_t size, size_t nitems, void *outstream) -> size_t
+		{
+			reinterpret_cast<std::string*>(outstream)->append(buffer, size * nitems);
+			return size * nitems;
+		}));
+		curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &request->Result);
+
+		if (curl_multi_add_handle(_multiHandle, curlHandle) == CURLM_OK)
+		{
+			_activeRequests[curlHandle] = std::move(request);
+		}
+		else
+		{
+			CompleteRequest(*request, CURLE_COULDNT_CONNECT, 0);
+			CCurlHandlePool::Instance().Release(curlHandle);
+		}
+	}
+
+	void ProcessCompletedRequests()
+	{
+		int remaining = 0;
+		CURLMsg* message = nullptr;
+		while ((message = curl_multi_info_read(_multiHandle, &remaining)) != nullptr)
+		{
+			if (message->msg == CURLMSG_DONE)
+			{
+				CURL* curlHandle = message->easy_handle;
+				const CURLcode res = message->data.result;
+				curl_multi_remove_handle(_multiHandle, curlHandle);
+
+				auto it = _activeRequests.find(curlHandle);
+				if (it != _activeRequests.end())
+				{
+					std::unique_ptr<AsyncRequest> request = std::move(it->second);
+					_activeRequests.erase(it);
+
+					long httpCode = 0;
+					curl_easy_getinfo(curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
+					CompleteRequest(*request, res, httpCode);
+				}
+
+				CCurlHandlePool::Instance().Release(curlHandle);
+			}
+		}
+	}
+
+	void EventLoop()
+	{
+		_multiHandle = curl_multi_init();
+
+		bool stopRequested = false;
+		while (!stopRequested)
+		{
+			std::deque<std::unique_ptr<AsyncRequest>> newRequests;
+			{
+				std::unique_lock<std::mutex> l(_queueMutex);
+				if (_activeRequests.empty())
+				{
+					_queueNotify.wait(l, [this]() { return _stopRequested || !_pendingRequests.empty(); });
+				}
+				newRequests.swap(_pendingRequests);
+				stopRequested = _stopRequested;
+			}
+
+			for (auto& request : newRequests)
+			{
+				StartRequest(std::move(request));
+			}
+
+			int running = 0;
+			curl_multi_perform(_multiHandle, &running);
+			ProcessCompletedRequests();
+
+			// Short wait keeps newly queued requests responsive - curl 7.53 has no curl_multi_wakeup()
+			if (!_activeRequests.empty() && !stopRequested)
+			{
+				curl_multi_wait(_multiHandle, nullptr, 0, 10, nullptr);
+			}
+		}
+
+		for (auto& active : _activeRequests)
+		{
+			curl_multi_remove_handle(_multiHandle, active.first);
+			CompleteRequest(*active.second, CURLE_COULDNT_CONNECT, 0);
+			CCurlHandlePool::Instance().Release(active.first);
+		}
+		_activeRequests.clear();
+
+		curl_multi_cleanup(_multiHandle);
+		_multiHandle = nullptr;
+	}
+
+public:
+	void Submit(const std::string& url, const bool& isPost, const std::string& postFields, CompletionCallback completion)
+	{
+		std::unique_ptr<AsyncRequest> request(new AsyncRequest());
+		request->CurlHandle = CCurlHandlePool::Instance().Acquire();
+		request->Url = url;
+		request->IsPost = isPost;
+		request->PostFields = postFields;
+		request->Completion = completion;
+
+		{
+			std::lock_guard<std::mutex> l(_queueMutex);
+			if (_stopRequested)
+			{
+				CCurlHandlePool::Instance().Release(request->CurlHandle);
+				CompleteRequest(*request, CURLE_COULDNT_CONNECT, 0);
+				return;
+			}
+
+			_pendingRequests.push_back(std::move(request));
+			if (!_thread)
+			{
+				_thread.reset(new std::thread([this]() { EventLoop(); }));
+			}
+		}
+		_queueNotify.notify_one();
+	}
+};
+
 CSiaCurl::CSiaCurl()
 {
-	SetHostConfig({ L"localhost", 9980, L""});
+	SetHostConfig({ L"localhost", 9980, L"", DEFAULT_VERSION_CACHE_TTL_SECS });
 }
 
 CSiaCurl::CSiaCurl(const SiaHostConfig& hostConfig)
@@ -17,10 +484,45 @@ CSiaCurl::~CSiaCurl()
 {
 }
 
+void CSiaCurl::Startup()
+{
+	std::lock_guard<std::mutex> l(CurlLifetimeMutex);
+	CurlStartupCount++;
+}
+
+// Callers must have stopped issuing requests. The engine goes first - its thread releases in-flight handles into
+//	the pool, and the pool performs curl's global cleanup.
+void CSiaCurl::Shutdown()
+{
+	CCurlMultiEngine* curlMultiEngine = nullptr;
+	CCurlHandlePool* curlHandlePool = nullptr;
+	{
+		std::lock_guard<std::mutex> l(CurlLifetimeMutex);
+		if (CurlStartupCount && (--CurlStartupCount == 0))
+		{
+			curlMultiEngine = CurlMultiEngine.exchange(nullptr);
+			curlHandlePool = CurlHandlePool.exchange(nullptr);
+		}
+	}
+
+	delete curlMultiEngine;
+	delete curlHandlePool;
+}
+
+SiaCurlMetrics CSiaCurl::GetMetrics()
+{
+	SiaCurlMetrics ret;
+	ret.PoolHits = CCurlHandlePool::Instance().GetPoolHits();
+	ret.PoolMisses = CCurlHandlePool::Instance().GetPoolMisses();
+	ret.VersionCacheHits = CVersionCache::Instance().GetCacheHits();
+	ret.VersionValidations = CVersionCache::Instance().GetValidations();
+
+	return ret;
+}
+
 SString CSiaCurl::UrlEncode(const SString& data, const bool& allowSlash)
 {
-	CURL* curlHandle = curl_easy_init();
-	curl_easy_reset(curlHandle);
+	CPooledCurlHandle curlHandle;
 
 	char* value = curl_easy_escape(curlHandle, SString::ToUtf8(data).c_str(), 0);
 	SString ret = value;
@@ -30,8 +532,6 @@ SString CSiaCurl::UrlEncode(const SString& data, const bool& allowSlash)
 		ret.Replace("%2F", "/");
 	}
 
-	curl_easy_cleanup(curlHandle);
-
 	return ret;
 }
 
@@ -67,6 +567,8 @@ SiaCurlError CSiaCurl::ProcessResponse(const int& res, const int& httpCode, cons
 	{
 		if ((res == CURLE_COULDNT_RESOLVE_HOST) || (res == CURLE_COULDNT_CONNECT))
 		{
+			// siad may have been restarted or replaced - verify version again on next request
+			CVersionCache::Instance().Invalidate(GetHostConfig());
 			ret = SiaCurlErrorCode::NoResponse;
 		}
 		else if (httpCode)
@@ -82,10 +584,8 @@ SiaCurlError CSiaCurl::ProcessResponse(const int& res, const int& httpCode, cons
 	return ret;
 }
 
-SiaCurlError CSiaCurl::_Get(const SString& path, const HttpParameters& parameters, json& response) const
+std::string CSiaCurl::ConstructUrl(const SString& path, const HttpParameters& parameters) const
 {
-	CURL* curlHandle = curl_easy_init();
-	curl_easy_reset(curlHandle);
 	SString url = ConstructPath(path);
 	if (parameters.size())
 	{
@@ -99,24 +599,45 @@ SiaCurlError CSiaCurl::_Get(const SString& path, const HttpParameters& parameter
 			url += (param.first + "=" + UrlEncode(param.second));
 		}
 	}
-	curl_easy_setopt(curlHandle, CURLOPT_USERAGENT, "Sia-Agent");
-	curl_easy_setopt(curlHandle, CURLOPT_URL, SString::ToUtf8(url).c_str());
+
+	return SString::ToUtf8(url);
+}
+
+std::string CSiaCurl::ConstructPostFields(const HttpParameters& parameters)
+{
+	SString fields;
+	for (const auto& param : parameters)
+	{
+		if (fields.Length())
+		{
+			fields += "&";
+		}
+
+		fields += (param.first + "=" + param.second);
+	}
+
+	return SString::ToUtf8(fields);
+}
+
+SiaCurlError CSiaCurl::_Get(const SString& path, const HttpParameters& parameters, json& response) const
+{
+	CPooledCurlHandle curlHandle;
+	const std::string url = ConstructUrl(path, parameters);
+	curl_easy_setopt(curlHandle, CURLOPT_URL, url.c_str());
 	curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, static_cast<size_t(*)(char*, size_t, size_t, void *)>([](char *buffer, size_t size, size_t nitems, void *outstream) -> size_t
 	{
-		(*reinterpret_cast<SString*>(outstream)) += std::string(buffer, size * nitems);
+		reinterpret_cast<std::string*>(outstream)->append(buffer, size * nitems);
 		return size * nitems;
 	}));
 
-	SString result;
+	std::string result;
 	curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &result);
 	const CURLcode res = curl_easy_perform(curlHandle);
 
 	long httpCode = 0;
 	curl_easy_getinfo(curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
 
-	SiaCurlError ret = ProcessResponse(res, httpCode, result, response);
-	curl_easy_cleanup(curlHandle);
-	return ret;
+	return ProcessResponse(res, httpCode, result, response);
 }
 
 bool CSiaCurl::CheckVersion(SiaCurlError& error) const
@@ -125,7 +646,16 @@ bool CSiaCurl::CheckVersion(SiaCurlError& error) const
 	if (GetHostConfig().RequiredVersion.Length())
 	{
 		error = SiaCurlErrorCode::NoResponse;
-		const SString serverVersion = GetServerVersion();
+		SString serverVersion;
+		if (!CVersionCache::Instance().Find(GetHostConfig(), serverVersion))
+		{
+			serverVersion = GetServerVersion();
+			if (serverVersion.Length())
+			{
+				CVersionCache::Instance().Update(GetHostConfig(), serverVersion);
+			}
+		}
+
 		if (serverVersion.Length())
 		{
 			error = (serverVersion == GetHostConfig().RequiredVersion) ? SiaCurlErrorCode::Success : SiaCurlErrorCode::ServerVersionMismatch;
@@ -173,32 +703,18 @@ SiaCurlError CSiaCurl::Post(const SString& path, const HttpParameters& parameter
 	SiaCurlError ret;
 	if (CheckVersion(ret))
 	{
-		CURL* curlHandle = curl_easy_init();
-		curl_easy_reset(curlHandle);
-
-		curl_easy_setopt(curlHandle, CURLOPT_USERAGENT, "Sia-Agent");
+		CPooledCurlHandle curlHandle;
 		curl_easy_setopt(curlHandle, CURLOPT_URL, ConstructPath(path).c_str());
 		curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, static_cast<size_t(*)(char*, size_t, size_t, void *)>([](char *buffer, size_t size, size_t nitems, void *outstream) -> size_t
 		{
-			(*reinterpret_cast<SString*>(outstream)) += std::string(buffer, size * nitems);
+			reinterpret_cast<std::string*>(outstream)->append(buffer, size * nitems);
 			return size * nitems;
 		}));
 
-		SString fields;
-		for (const auto& param : parameters)
-		{
-			if (fields.Length())
-			{
-				fields += "&";
-			}
-
-			fields += (param.first + "=" + param.second);
-		}
-
-    std::string utf8Fields = SString::ToUtf8(fields);
+		std::string utf8Fields = ConstructPostFields(parameters);
 		curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, &utf8Fields[0]);
 
-		SString result;
+		std::string result;
 		curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &result);
 		const CURLcode res = curl_easy_perform(curlHandle);
 
@@ -206,8 +722,174 @@ SiaCurlError CSiaCurl::Post(const SString& path, const HttpParameters& parameter
 		curl_easy_getinfo(curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
 
 		ret = ProcessResponse(res, httpCode, result, response);
-		curl_easy_cleanup(curlHandle);
 	}
 
 	return ret;
+}
+
+SiaCurlError CSiaCurl::GetStream(const SString& path, const HttpParameters& parameters, SiaCurlStreamCallback streamCallback) const
+{
+	SiaCurlError ret;
+	if (CheckVersion(ret))
+	{
+		typedef struct
+		{
+			CURL* CurlHandle;
+			SiaCurlStreamCallback StreamCallback;
+			std::string ErrorBody;
+			bool Rejected;
+		} StreamContext;
+
+		CPooledCurlHandle curlHandle;
+		const std::string url = ConstructUrl(path, parameters);
+		StreamContext streamContext = { curlHandle, streamCallback, "", false };
+		curl_easy_setopt(curlHandle, CURLOPT_URL, url.c_str());
+		curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, static_cast<size_t(*)(char*, size_t, size_t, void *)>([](char *buffer, size_t size, size_t nitems, void *outstream) -> size_t
+		{
+			auto* context = reinterpret_cast<StreamContext*>(outstream);
+			long httpCode = 0;
+			curl_easy_getinfo(context->CurlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
+
+			// Only successful responses are streamed - error bodies are small and parsed as usual
+			if ((httpCode >= 200) && (httpCode < 300))
+			{
+				if (!context->StreamCallback(buffer, size * nitems))
+				{
+					context->Rejected = true;
+					return 0;
+				}
+			}
+			else
+			{
+				context->ErrorBody.append(buffer, size * nitems);
+			}
+
+			return size * nitems;
+		}));
+		curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &streamContext);
+		const CURLcode res = curl_easy_perform(curlHandle);
+
+		long httpCode = 0;
+		curl_easy_getinfo(curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
+
+		if (streamContext.Rejected)
+		{
+			ret = { SiaCurlErrorCode::UnknownFailure, "Invalid response stream" };
+		}
+		else
+		{
+			json response;
+			ret = ProcessResponse(res, httpCode, streamContext.ErrorBody, response);
+		}
+	}
+
+	return ret;
+}
+
+void CSiaCurl::SubmitAsync(const bool& isPost, const SString& path, const HttpParameters& parameters, SiaCurlCallback callback) const
+{
+	const CSiaCurl siaCurl(GetHostConfig());
+	const std::string url = isPost ? ConstructPath(path) : ConstructUrl(path, parameters);
+	const std::string postFields = isPost ? ConstructPostFields(parameters) : "";
+	auto sendRequest = [siaCurl, isPost, url, postFields, callback]()
+	{
+		CCurlMultiEngine::Instance().Submit(url, isPost, postFields, [siaCurl, callback](const CURLcode& res, const long& httpCode, const std::string& result)
+		{
+			SiaCurlResult curlResult;
+			try
+			{
+				curlResult.Error = siaCurl.ProcessResponse(res, httpCode, result, curlResult.Response);
+			}
+			catch (const std::exception& e)
+			{
+				curlResult.Error = { SiaCurlErrorCode::UnknownFailure, e.what() };
+			}
+			callback(curlResult);
+		});
+	};
+
+	const SString requiredVersion = GetHostConfig().RequiredVersion;
+	SString serverVersion;
+	if (requiredVersion.IsNullOrEmpty())
+	{
+		SiaCurlResult curlResult;
+		curlResult.Error = SiaCurlErrorCode::InvalidRequiredVersion;
+		callback(curlResult);
+	}
+	else if (CVersionCache::Instance().Find(GetHostConfig(), serverVersion))
+	{
+		if (serverVersion == requiredVersion)
+		{
+			sendRequest();
+		}
+		else
+		{
+			SiaCurlResult curlResult;
+			curlResult.Error = SiaCurlErrorCode::ServerVersionMismatch;
+			callback(curlResult);
+		}
+	}
+	else
+	{
+		// Verify version without blocking the caller, then issue the actual request
+		CCurlMultiEngine::Instance().Submit(ConstructUrl(L"/daemon/version", {}), false, "", [siaCurl, requiredVersion, sendRequest, callback](const CURLcode& res, const long& httpCode, const std::string& result)
+		{
+			SiaCurlResult curlResult;
+			SString serverVersion;
+			try
+			{
+				json response;
+				if (ApiSuccess(siaCurl.ProcessResponse(res, httpCode, result, response)))
+				{
+					serverVersion = response["version"].get<std::string>();
+				}
+			}
+			catch (const std::exception&)
+			{
+			}
+
+			if (serverVersion.IsNullOrEmpty())
+			{
+				curlResult.Error = SiaCurlErrorCode::NoResponse;
+				callback(curlResult);
+			}
+			else
+			{
+				CVersionCache::Instance().Update(siaCurl.GetHostConfig(), serverVersion);
+				if (serverVersion == requiredVersion)
+				{
+					sendRequest();
+				}
+				else
+				{
+					curlResult.Error = SiaCurlErrorCode::ServerVersionMismatch;
+					callback(curlResult);
+				}
+			}
+		});
+	}
+}
+
+void CSiaCurl::GetAsync(const SString& path, const HttpParameters& parameters, SiaCurlCallback callback) const
+{
+	SubmitAsync(false, path, parameters, callback);
+}
+
+void CSiaCurl::PostAsync(const SString& path, const HttpParameters& parameters, SiaCurlCallback callback) const
+{
+	SubmitAsync(true, path, parameters, callback);
+}
+
+std::future<SiaCurlResult> CSiaCurl::GetAsync(const SString& path, const HttpParameters& parameters) const
+{
+	auto promise = std::make_shared<std::promise<SiaCurlResult>>();
+	SubmitAsync(false, path, parameters, [promise](const SiaCurlResult& curlResult) { promise->set_value(curlResult); });
+	return promise->get_future();
+}
+
+std::future<SiaCurlResult> CSiaCurl::PostAsync(const SString& path, const HttpParameters& parameters) const
+{
+	auto promise = std::make_shared<std::promise<SiaCurlResult>>();
+	SubmitAsync(true, path, parameters, [promise](const SiaCurlResult& curlResult) { promise->set_value(curlResult); });
+	return promise->get_future();
 }
\ No newline at end of file
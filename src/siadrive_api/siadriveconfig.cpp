@@ -26,6 +26,7 @@ CSiaDriveConfig::~CSiaDriveConfig()
 void CSiaDriveConfig::LoadDefaults()
 {
 	SetRenter_UploadDbFilePath(static_cast<SString>(FilePath(DEFAULT_RENTER_DB_FILE_PATH)));
+	SetRenter_FileTreeSnapshotFilePath(static_cast<SString>(FilePath(DEFAULT_FILE_TREE_SNAPSHOT_FILE_PATH)));
 
 	FilePath tempFolder = FilePath::GetTempDirectory();
 	SetTempFolder(static_cast<SString>(tempFolder));
@@ -38,6 +39,18 @@ void CSiaDriveConfig::LoadDefaults()
   SetHostNameOrIp("localhost");
   SetHostPort(9980);
   SetMaxUploadCount(5);
+  SetUploadOrderPolicy("fair_share");
+  SetUploadQuietPeriodSecs(DEFAULT_UPLOAD_QUIET_PERIOD_SECS);
+  SetEnableSmallFilePacking(false);
+  SetSmallFileThresholdBytes(DEFAULT_SMALL_FILE_THRESHOLD_BYTES);
+  SetBundleTargetBytes(DEFAULT_BUNDLE_TARGET_BYTES);
+  SetBundleCompactionPercent(DEFAULT_BUNDLE_COMPACTION_PERCENT);
+  SetUploadLimitKBps(0);
+  SetDownloadLimitKBps(0);
+  SetBandwidthSchedule("");
+  SetUploadStallTimeoutMins(DEFAULT_UPLOAD_STALL_TIMEOUT_MINS);
+  SetVersionCacheTtlSecs(DEFAULT_VERSION_CACHE_TTL_SECS);
+  SetFileTreeFreshnessMs(DEFAULT_FILE_TREE_FRESHNESS_MS);
 }
 
 void CSiaDriveConfig::Load( )
@@ -49,8 +62,19 @@ void CSiaDriveConfig::Load( )
 		std::stringstream ss;
 		ss << myfile.rdbuf();
 		std::string jsonTxt = ss.str();
-		_configDocument = json::parse(jsonTxt.begin(), jsonTxt.end());
 		myfile.close();
+
+		// Settings added after the file was created fall back to defaults
+		LoadDefaults();
+		json defaults = _configDocument;
+		_configDocument = json::parse(jsonTxt.begin(), jsonTxt.end());
+		for (auto it = defaults.begin(); it != defaults.end(); it++)
+		{
+			if (_configDocument.find(it.key()) == _configDocument.end())
+			{
+				_configDocument[it.key()] = it.value();
+			}
+		}
 	}
 	else
 	{
@@ -2,15 +2,9 @@
 
 using namespace Sia::Api;
 
-CSiaApi::_CSiaFile::_CSiaFile(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, const json& fileJson) :
-	CSiaBase(siaCurl, siaDriveConfig),
-	_SiaPath(fileJson["siapath"].get<std::string>()),
-	_FileSize(fileJson["filesize"].get<std::uint64_t>()),
-	_Available(fileJson["available"].get<bool>()),
-	_Renewing(fileJson["renewing"].get<bool>()),
-	_Redundancy(fileJson["redundancy"].get<std::uint32_t>()),
-	_UploadProgress(fileJson["uploadprogress"].get<std::uint32_t>()),
-	_Expiration(fileJson["expiration"].get<std::uint32_t>())
+CSiaApi::_CSiaFile::_CSiaFile(CSiaFileStorePtr fileStore, const std::uint32_t& index) :
+	_fileStore(fileStore),
+	_index(index)
 {
 	
 }
@@ -18,4 +12,39 @@ CSiaApi::_CSiaFile::_CSiaFile(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDrive
 CSiaApi::_CSiaFile::~_CSiaFile()
 {
 	
-}
\ No newline at end of file
+}
+
+SString CSiaApi::_CSiaFile::GetSiaPath() const
+{
+	return _fileStore->GetSiaPath(_index);
+}
+
+std::uint64_t CSiaApi::_CSiaFile::GetFileSize() const
+{
+	return _fileStore->GetFileSize(_index);
+}
+
+bool CSiaApi::_CSiaFile::GetAvailable() const
+{
+	return _fileStore->GetAvailable(_index);
+}
+
+bool CSiaApi::_CSiaFile::GetRenewing() const
+{
+	return _fileStore->GetRenewing(_index);
+}
+
+std::uint32_t CSiaApi::_CSiaFile::GetRedundancy() const
+{
+	return _fileStore->GetRedundancy(_index);
+}
+
+std::uint32_t CSiaApi::_CSiaFile::GetUploadProgress() const
+{
+	return _fileStore->GetUploadProgress(_index);
+}
+
+std::uint32_t CSiaApi::_CSiaFile::GetExpiration() const
+{
+	return _fileStore->GetExpiration(_index);
+}
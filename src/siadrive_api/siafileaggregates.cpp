@@ -0,0 +1,136 @@
+#include <siafileaggregates.h>
+
+using namespace Sia::Api;
+
+const SString CSiaFileAggregates::TotalUsedBytes = L"TotalUsedBytes";
+const SString CSiaFileAggregates::TotalUploadProgress = L"TotalUploadProgress";
+const SString CSiaFileAggregates::PendingUploadBytes = L"PendingUploadBytes";
+const SString CSiaFileAggregates::UnavailableFileCount = L"UnavailableFileCount";
+
+CSiaFileAggregates::CSiaFileAggregates() :
+	_fileCount(0)
+{
+	Register(TotalUsedBytes, [](const CSiaFileStore& fileStore, const std::uint32_t& index) -> std::int64_t
+	{
+		return static_cast<std::int64_t>(fileStore.GetFileSize(index));
+	});
+
+	// Sum of per-file progress (capped at 100) - divide by file count for the average
+	Register(TotalUploadProgress, [](const CSiaFileStore& fileStore, const std::uint32_t& index) -> std::int64_t
+	{
+		return min(100, fileStore.GetUploadProgress(index));
+	});
+
+	Register(PendingUploadBytes, [](const CSiaFileStore& fileStore, const std::uint32_t& index) -> std::int64_t
+	{
+		return fileStore.GetAvailable(index) ? 0 : static_cast<std::int64_t>(fileStore.GetFileSize(index));
+	});
+
+	Register(UnavailableFileCount, [](const CSiaFileStore& fileStore, const std::uint32_t& index) -> std::int64_t
+	{
+		return fileStore.GetAvailable(index) ? 0 : 1;
+	});
+}
+
+CSiaFileAggregates::~CSiaFileAggregates()
+{
+}
+
+void CSiaFileAggregates::AddFile(const CSiaFileStore& fileStore, const std::uint32_t& index, const std::int64_t& sign)
+{
+	for (std::size_t i = 0; i < _contributions.size(); i++)
+	{
+		_values[i] += sign * _contributions[i](fileStore, index);
+	}
+
+	auto& expiringBytes = _expiringBytes[fileStore.GetExpiration(index)];
+	expiringBytes += sign * static_cast<std::int64_t>(fileStore.GetFileSize(index));
+	if (!expiringBytes)
+	{
+		_expiringBytes.erase(fileStore.GetExpiration(index));
+	}
+
+	_fileCount += sign;
+}
+
+// New kinds are seeded from the current listing once, then maintained with the rest
+bool CSiaFileAggregates::Register(const SString& name, Contribution contribution)
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	const bool ret = (_kindIndex.find(name) == _kindIndex.end());
+	if (ret)
+	{
+		std::int64_t value = 0;
+		if (_fileStore)
+		{
+			for (std::uint32_t i = 0; i < _fileStore->GetCount(); i++)
+			{
+				value += contribution(*_fileStore, i);
+			}
+		}
+
+		_kindIndex.insert({ name, _contributions.size() });
+		_contributions.push_back(contribution);
+		_values.push_back(value);
+	}
+
+	return ret;
+}
+
+void CSiaFileAggregates::Reset(CSiaFileStorePtr fileStore)
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	std::fill(_values.begin(), _values.end(), 0);
+	_expiringBytes.clear();
+	_fileCount = 0;
+	for (std::uint32_t i = 0; i < fileStore->GetCount(); i++)
+	{
+		AddFile(*fileStore, i, 1);
+	}
+	_fileStore = fileStore;
+}
+
+// Each changed row is (current index, previous index), with CSiaFileStore::NoIndex for added or removed files
+void CSiaFileAggregates::Apply(CSiaFileStorePtr fileStore, const CSiaFileStore& previous, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& changedRows)
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	for (const auto& row : changedRows)
+	{
+		if (row.second != CSiaFileStore::NoIndex)
+		{
+			AddFile(previous, row.second, -1);
+		}
+
+		if (row.first != CSiaFileStore::NoIndex)
+		{
+			AddFile(*fileStore, row.first, 1);
+		}
+	}
+	_fileStore = fileStore;
+}
+
+std::int64_t CSiaFileAggregates::Get(const SString& name) const
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	auto it = _kindIndex.find(name);
+	return ((it == _kindIndex.end()) ? 0 : _values[it->second]);
+}
+
+std::uint64_t CSiaFileAggregates::GetFileCount() const
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	return _fileCount;
+}
+
+// Proportional to the number of distinct expiration heights below 'blockHeight', not the number of files
+std::uint64_t CSiaFileAggregates::GetBytesExpiringBefore(const std::uint64_t& blockHeight) const
+{
+	std::lock_guard<std::mutex> l(_aggregateMutex);
+	std::uint64_t ret = 0;
+	for (auto it = _expiringBytes.begin(); (it != _expiringBytes.end()) && (it->first < blockHeight); it++)
+	{
+		ret += it->second;
+	}
+
+	return ret;
+}
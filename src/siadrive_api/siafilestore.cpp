@@ -0,0 +1,569 @@
+#include <siafilestore.h>
+#include <filepath.h>
+#include <cstring>
+
+using namespace Sia::Api;
+
+#define SNAPSHOT_MAGIC "SIAFTREE"
+#define SNAPSHOT_VERSION 1
+#define EMPTY_PATH_SLOT 0xFFFFFFFF
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static inline std::uint64_t HashBytes(std::uint64_t hash, const char* data, const std::size_t& length)
+{
+	for (std::size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ static_cast<std::uint8_t>(data[i])) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static inline std::uint64_t AlignSection(const std::uint64_t& offset)
+{
+	return (offset + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+// Offsets into an arena must start at 0, never decrease and end at the arena's size
+static bool IsOffsetTableValid(const std::uint32_t* offsets, const std::uint32_t& count, const std::uint64_t& arenaSize)
+{
+	bool ret = (offsets[0] == 0) && (offsets[count] == arenaSize);
+	for (std::uint32_t i = 0; ret && (i < count); i++)
+	{
+		ret = (offsets[i] <= offsets[i + 1]);
+	}
+
+	return ret;
+}
+
+static bool IsIndexColumnValid(const std::uint32_t* values, const std::uint32_t& count, const std::uint32_t& limit)
+{
+	bool ret = true;
+	for (std::uint32_t i = 0; ret && (i < count); i++)
+	{
+		ret = (values[i] < limit);
+	}
+
+	return ret;
+}
+
+// Every file occupies exactly one slot, so probing always reaches an empty one
+static bool IsPathSlotTableValid(const std::uint32_t* slots, const std::uint32_t& slotCount, const std::uint32_t& fileCount)
+{
+	std::uint32_t used = 0;
+	bool ret = true;
+	for (std::uint32_t i = 0; ret && (i < slotCount); i++)
+	{
+		if (slots[i] != EMPTY_PATH_SLOT)
+		{
+			ret = (slots[i] < fileCount);
+			used++;
+		}
+	}
+
+	return ret && (used == fileCount);
+}
+
+const std::uint32_t CSiaFileStore::NoIndex = EMPTY_PATH_SLOT;
+
+CSiaFileStore::CSiaFileStore() :
+	_directoryOffsets({ 0 }),
+	_nameOffsets({ 0 }),
+	_mappedSize(0),
+	_fileCount(0),
+	_directoryCount(0),
+	_pathSlotCount(0),
+	_directoryArenaData(nullptr),
+	_directoryOffsetsData(nullptr),
+	_nameArenaData(nullptr),
+	_nameOffsetsData(nullptr),
+	_directoryIdsData(nullptr),
+	_fileSizesData(nullptr),
+	_redundancyData(nullptr),
+	_uploadProgressData(nullptr),
+	_expirationData(nullptr),
+	_flagsData(nullptr),
+	_pathSlotsData(nullptr)
+{
+}
+
+CSiaFileStore::~CSiaFileStore()
+{
+}
+
+// Sections follow the header in a fixed order, each 8-byte aligned
+CSiaFileStore::_SnapshotLayout CSiaFileStore::CreateSnapshotLayout(const _SnapshotHeader& header)
+{
+	_SnapshotLayout layout;
+	layout.Tag = AlignSection(sizeof(_SnapshotHeader));
+	layout.FileSizes = AlignSection(layout.Tag + header.TagSize);
+	layout.DirectoryOffsets = AlignSection(layout.FileSizes + header.FileCount * sizeof(std::uint64_t));
+	layout.NameOffsets = AlignSection(layout.DirectoryOffsets + (header.DirectoryCount + 1ULL) * sizeof(std::uint32_t));
+	layout.DirectoryIds = AlignSection(layout.NameOffsets + (header.FileCount + 1ULL) * sizeof(std::uint32_t));
+	layout.Redundancy = AlignSection(layout.DirectoryIds + header.FileCount * sizeof(std::uint32_t));
+	layout.UploadProgress = AlignSection(layout.Redundancy + header.FileCount * sizeof(std::uint32_t));
+	layout.Expiration = AlignSection(layout.UploadProgress + header.FileCount * sizeof(std::uint32_t));
+	layout.PathSlots = AlignSection(layout.Expiration + header.FileCount * sizeof(std::uint32_t));
+	layout.Flags = AlignSection(layout.PathSlots + header.PathSlotCount * sizeof(std::uint32_t));
+	layout.DirectoryArena = AlignSection(layout.Flags + header.FileCount);
+	layout.NameArena = AlignSection(layout.DirectoryArena + header.DirectoryArenaSize);
+	layout.End = layout.NameArena + header.NameArenaSize;
+
+	return layout;
+}
+
+std::uint32_t CSiaFileStore::InternDirectory(const std::string& directory)
+{
+	auto it = _directoryLookup.find(directory);
+	if (it == _directoryLookup.end())
+	{
+		_directoryArena.append(directory);
+		_directoryOffsets.push_back(static_cast<std::uint32_t>(_directoryArena.size()));
+		it = _directoryLookup.insert({ directory, _directoryCount++ }).first;
+	}
+
+	return it->second;
+}
+
+void CSiaFileStore::BindColumns()
+{
+	_directoryArenaData = _directoryArena.data();
+	_directoryOffsetsData = _directoryOffsets.data();
+	_nameArenaData = _nameArena.data();
+	_nameOffsetsData = _nameOffsets.data();
+	_directoryIdsData = _directoryIds.data();
+	_fileSizesData = _fileSizes.data();
+	_redundancyData = _redundancy.data();
+	_uploadProgressData = _uploadProgress.data();
+	_expirationData = _expiration.data();
+	_flagsData = _flags.data();
+	_pathSlotsData = _pathSlots.data();
+	_pathSlotCount = static_cast<std::uint32_t>(_pathSlots.size());
+}
+
+// Hashes '<directory>/<name>' (or '<name>' at root) without materializing the path
+std::uint64_t CSiaFileStore::HashPath(const std::uint32_t& index) const
+{
+	const std::uint32_t directoryId = _directoryIdsData[index];
+	const std::uint32_t directoryLength = _directoryOffsetsData[directoryId + 1] - _directoryOffsetsData[directoryId];
+
+	std::uint64_t hash = HashBytes(FNV_OFFSET_BASIS, &_directoryArenaData[_directoryOffsetsData[directoryId]], directoryLength);
+	if (directoryLength)
+	{
+		hash = HashBytes(hash, "/", 1);
+	}
+
+	return HashBytes(hash, &_nameArenaData[_nameOffsetsData[index]], _nameOffsetsData[index + 1] - _nameOffsetsData[index]);
+}
+
+bool CSiaFileStore::PathEquals(const std::uint32_t& index, const std::string& siaPath) const
+{
+	const std::uint32_t directoryId = _directoryIdsData[index];
+	const std::uint32_t directoryLength = _directoryOffsetsData[directoryId + 1] - _directoryOffsetsData[directoryId];
+	const std::uint32_t nameLength = _nameOffsetsData[index + 1] - _nameOffsetsData[index];
+	const std::size_t separatorLength = directoryLength ? 1 : 0;
+
+	return (siaPath.length() == directoryLength + separatorLength + nameLength) &&
+		(siaPath.compare(0, directoryLength, &_directoryArenaData[_directoryOffsetsData[directoryId]], directoryLength) == 0) &&
+		(!separatorLength || (siaPath[directoryLength] == '/')) &&
+		(siaPath.compare(directoryLength + separatorLength, nameLength, &_nameArenaData[_nameOffsetsData[index]], nameLength) == 0);
+}
+
+std::uint32_t CSiaFileStore::Add(const json& fileJson)
+{
+	return Add(fileJson["siapath"].get<std::string>(),
+		fileJson["filesize"].get<std::uint64_t>(),
+		fileJson["available"].get<bool>(),
+		fileJson["renewing"].get<bool>(),
+		fileJson["redundancy"].get<std::uint32_t>(),
+		fileJson["uploadprogress"].get<std::uint32_t>(),
+		fileJson["expiration"].get<std::uint32_t>());
+}
+
+std::uint32_t CSiaFileStore::Add(const std::string& siaPath, const std::uint64_t& fileSize, const bool& available, const bool& renewing, const std::uint32_t& redundancy, const std::uint32_t& uploadProgress, const std::uint32_t& expiration)
+{
+	const std::size_t idx = siaPath.find_last_of('/');
+
+	_directoryIds.push_back(InternDirectory((idx == std::string::npos) ? std::string() : siaPath.substr(0, idx)));
+	_nameArena.append(siaPath, (idx == std::string::npos) ? 0 : idx + 1, std::string::npos);
+	_nameOffsets.push_back(static_cast<std::uint32_t>(_nameArena.size()));
+	_fileSizes.push_back(fileSize);
+	_redundancy.push_back(redundancy);
+	_uploadProgress.push_back(uploadProgress);
+	_expiration.push_back(expiration);
+	_flags.push_back((available ? _FileFlags::Available : 0) | (renewing ? _FileFlags::Renewing : 0));
+
+	return _fileCount++;
+}
+
+// Called once all files are added - releases build-time state and builds the path table
+void CSiaFileStore::Seal()
+{
+	if (IsMapped())
+	{
+		return;
+	}
+
+	_directoryLookup.clear();
+	_directoryLookup.rehash(0);
+	_directoryArena.shrink_to_fit();
+	_directoryOffsets.shrink_to_fit();
+	_nameArena.shrink_to_fit();
+	_nameOffsets.shrink_to_fit();
+	_directoryIds.shrink_to_fit();
+	_fileSizes.shrink_to_fit();
+	_redundancy.shrink_to_fit();
+	_uploadProgress.shrink_to_fit();
+	_expiration.shrink_to_fit();
+	_flags.shrink_to_fit();
+
+	// Power of two, at most half full
+	std::size_t slotCount = 16;
+	while (slotCount < (static_cast<std::size_t>(GetCount()) * 2))
+	{
+		slotCount <<= 1;
+	}
+
+	BindColumns();
+	_pathSlots.assign(slotCount, EMPTY_PATH_SLOT);
+	for (std::uint32_t i = 0; i < GetCount(); i++)
+	{
+		std::size_t slot = static_cast<std::size_t>(HashPath(i)) & (slotCount - 1);
+		while (_pathSlots[slot] != EMPTY_PATH_SLOT)
+		{
+			slot = (slot + 1) & (slotCount - 1);
+		}
+		_pathSlots[slot] = i;
+	}
+	BindColumns();
+}
+
+// Windows compares names by upper-casing both sides
+std::wstring CSiaFileStore::FoldCase(const std::string& siaPath)
+{
+	std::wstring ret = SString::FromUtf8(siaPath);
+#ifdef _WIN32
+	if (!ret.empty())
+	{
+		::CharUpperBuffW(&ret[0], static_cast<DWORD>(ret.length()));
+	}
+#else
+	a
+#endif
+
+	return ret;
+}
+
+std::uint64_t CSiaFileStore::HashFolded(const std::wstring& foldedPath)
+{
+	return HashBytes(FNV_OFFSET_BASIS, reinterpret_cast<const char*>(foldedPath.c_str()), foldedPath.length() * sizeof(wchar_t));
+}
+
+// Files whose paths differ only in case can't both be represented on the drive - each such pair is
+//	recorded as a collision. The folded table keeps the first file listed. Built on first use, since most
+//	stores are replaced by the next refresh without ever being searched case-insensitively.
+void CSiaFileStore::BuildFoldedIndex() const
+{
+	std::call_once(_foldedOnce, [this]()
+	{
+		std::vector<std::uint64_t> foldedHashes(_fileCount);
+		std::vector<std::uint32_t> foldedSlots(_pathSlotCount, EMPTY_PATH_SLOT);
+		std::vector<std::wstring> foldedPaths(_fileCount);
+		const std::size_t mask = _pathSlotCount - 1;
+		for (std::uint32_t i = 0; i < _fileCount; i++)
+		{
+			foldedPaths[i] = FoldCase(GetSiaPathUtf8(i));
+			foldedHashes[i] = HashFolded(foldedPaths[i]);
+
+			bool collision = false;
+			std::size_t slot = static_cast<std::size_t>(foldedHashes[i]) & mask;
+			while (!collision && (foldedSlots[slot] != EMPTY_PATH_SLOT))
+			{
+				const std::uint32_t existing = foldedSlots[slot];
+				collision = (foldedHashes[existing] == foldedHashes[i]) && (foldedPaths[existing] == foldedPaths[i]);
+				if (collision)
+				{
+					_caseCollisions.push_back({ existing, i });
+				}
+				slot = (slot + 1) & mask;
+			}
+
+			if (!collision)
+			{
+				foldedSlots[slot] = i;
+			}
+		}
+
+		_foldedHashes = std::move(foldedHashes);
+		_foldedSlots = std::move(foldedSlots);
+	});
+}
+
+bool CSiaFileStore::SaveSnapshot(const SString& filePath, const std::string& tag) const
+{
+#ifdef _WIN32
+	_SnapshotHeader header = { { 0 } };
+	std::memcpy(header.Magic, SNAPSHOT_MAGIC, sizeof(header.Magic));
+	header.Version = SNAPSHOT_VERSION;
+	header.FileCount = _fileCount;
+	header.DirectoryCount = _directoryCount;
+	header.PathSlotCount = _pathSlotCount;
+	header.DirectoryArenaSize = _directoryOffsetsData[_directoryCount];
+	header.NameArenaSize = _nameOffsetsData[_fileCount];
+	header.TagSize = tag.length();
+	const _SnapshotLayout layout = CreateSnapshotLayout(header);
+	header.TotalSize = layout.End;
+
+	std::vector<std::pair<std::uint64_t, std::pair<const void*, std::uint64_t>>> sections =
+	{
+		{ 0, { &header, sizeof(header) } },
+		{ layout.Tag, { tag.data(), tag.length() } },
+		{ layout.FileSizes, { _fileSizesData, _fileCount * sizeof(std::uint64_t) } },
+		{ layout.DirectoryOffsets, { _directoryOffsetsData, (_directoryCount + 1ULL) * sizeof(std::uint32_t) } },
+		{ layout.NameOffsets, { _nameOffsetsData, (_fileCount + 1ULL) * sizeof(std::uint32_t) } },
+		{ layout.DirectoryIds, { _directoryIdsData, _fileCount * sizeof(std::uint32_t) } },
+		{ layout.Redundancy, { _redundancyData, _fileCount * sizeof(std::uint32_t) } },
+		{ layout.UploadProgress, { _uploadProgressData, _fileCount * sizeof(std::uint32_t) } },
+		{ layout.Expiration, { _expirationData, _fileCount * sizeof(std::uint32_t) } },
+		{ layout.PathSlots, { _pathSlotsData, _pathSlotCount * sizeof(std::uint32_t) } },
+		{ layout.Flags, { _flagsData, _fileCount } },
+		{ layout.DirectoryArena, { _directoryArenaData, header.DirectoryArenaSize } },
+		{ layout.NameArena, { _nameArenaData, header.NameArenaSize } }
+	};
+
+	FilePath folder(filePath);
+	folder.RemoveFileName();
+	if (!folder.IsDirectory())
+	{
+		folder.CreateDirectory();
+	}
+
+	// Write beside the active snapshot and swap it in, so a partial write is never loaded
+	const SString tempFilePath = filePath + L".tmp";
+	HANDLE file = ::CreateFile(tempFilePath.str().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	bool ret = (file != INVALID_HANDLE_VALUE);
+	if (ret)
+	{
+		const char padding[8] = { 0 };
+		std::uint64_t written = 0;
+		for (auto it = sections.begin(); ret && (it != sections.end()); it++)
+		{
+			DWORD count;
+			if (written < it->first)
+			{
+				ret = ::WriteFile(file, padding, static_cast<DWORD>(it->first - written), &count, nullptr) ? true : false;
+				written = it->first;
+			}
+
+			const char* data = static_cast<const char*>(it->second.first);
+			std::uint64_t remain = it->second.second;
+			while (ret && remain)
+			{
+				const DWORD chunk = static_cast<DWORD>(min(remain, 0x10000000ULL));
+				ret = ::WriteFile(file, data, chunk, &count, nullptr) && (count == chunk);
+				data += chunk;
+				remain -= chunk;
+				written += chunk;
+			}
+		}
+		::CloseHandle(file);
+
+		// Fails while a previous snapshot is still mapped - callers retry on a later refresh
+		ret = ret && ::MoveFileEx(tempFilePath.str().c_str(), filePath.str().c_str(), MOVEFILE_REPLACE_EXISTING);
+		if (!ret)
+		{
+			FilePath(tempFilePath).DeleteFile();
+		}
+	}
+
+	return ret;
+#else
+	a
+#endif
+}
+
+std::shared_ptr<CSiaFileStore> CSiaFileStore::LoadSnapshot(const SString& filePath, const std::string& tag)
+{
+#ifdef _WIN32
+	std::shared_ptr<CSiaFileStore> ret;
+	HANDLE file = ::CreateFile(filePath.str().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER fileSize = { 0 };
+		HANDLE mapping = (::GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart >= static_cast<LONGLONG>(sizeof(_SnapshotHeader)))) ?
+			::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr) :
+			nullptr;
+		if (mapping)
+		{
+			const void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view)
+			{
+				// View remains valid after the handles are closed
+				std::shared_ptr<const void> mappedView(view, [](const void* v) { ::UnmapViewOfFile(v); });
+				const char* base = static_cast<const char*>(view);
+				const _SnapshotHeader& header = *reinterpret_cast<const _SnapshotHeader*>(base);
+				const _SnapshotLayout layout = CreateSnapshotLayout(header);
+
+				// Everything read through the view is checked up front - a corrupt snapshot is rebuilt from siad instead
+				//	of faulting later. Sizes are bounded before the layout is trusted so its sums can't wrap.
+				const bool valid = (std::memcmp(header.Magic, SNAPSHOT_MAGIC, sizeof(header.Magic)) == 0) &&
+					(header.Version == SNAPSHOT_VERSION) &&
+					(header.TotalSize == static_cast<std::uint64_t>(fileSize.QuadPart)) &&
+					(header.TagSize < header.TotalSize) &&
+					(header.DirectoryArenaSize < header.TotalSize) &&
+					(header.NameArenaSize < header.TotalSize) &&
+					(layout.End == header.TotalSize) &&
+					(header.PathSlotCount > header.FileCount) &&
+					((header.PathSlotCount & (header.PathSlotCount - 1)) == 0) &&
+					(std::string(base + layout.Tag, static_cast<std::size_t>(header.TagSize)) == tag) &&
+					IsOffsetTableValid(reinterpret_cast<const std::uint32_t*>(base + layout.DirectoryOffsets), header.DirectoryCount, header.DirectoryArenaSize) &&
+					IsOffsetTableValid(reinterpret_cast<const std::uint32_t*>(base + layout.NameOffsets), header.FileCount, header.NameArenaSize) &&
+					IsIndexColumnValid(reinterpret_cast<const std::uint32_t*>(base + layout.DirectoryIds), header.FileCount, header.DirectoryCount) &&
+					IsPathSlotTableValid(reinterpret_cast<const std::uint32_t*>(base + layout.PathSlots), header.PathSlotCount, header.FileCount);
+				if (valid)
+				{
+					ret.reset(new CSiaFileStore());
+					ret->_mappedView = mappedView;
+					ret->_mappedSize = header.TotalSize;
+					ret->_fileCount = header.FileCount;
+					ret->_directoryCount = header.DirectoryCount;
+					ret->_pathSlotCount = header.PathSlotCount;
+					ret->_fileSizesData = reinterpret_cast<const std::uint64_t*>(base + layout.FileSizes);
+					ret->_directoryOffsetsData = reinterpret_cast<const std::uint32_t*>(base + layout.DirectoryOffsets);
+					ret->_nameOffsetsData = reinterpret_cast<const std::uint32_t*>(base + layout.NameOffsets);
+					ret->_directoryIdsData = reinterpret_cast<const std::uint32_t*>(base + layout.DirectoryIds);
+					ret->_redundancyData = reinterpret_cast<const std::uint32_t*>(base + layout.Redundancy);
+					ret->_uploadProgressData = reinterpret_cast<const std::uint32_t*>(base + layout.UploadProgress);
+					ret->_expirationData = reinterpret_cast<const std::uint32_t*>(base + layout.Expiration);
+					ret->_pathSlotsData = reinterpret_cast<const std::uint32_t*>(base + layout.PathSlots);
+					ret->_flagsData = reinterpret_cast<const std::uint8_t*>(base + layout.Flags);
+					ret->_directoryArenaData = base + layout.DirectoryArena;
+					ret->_nameArenaData = base + layout.NameArena;
+				}
+			}
+			::CloseHandle(mapping);
+		}
+		::CloseHandle(file);
+	}
+
+	return ret;
+#else
+	a
+#endif
+}
+
+bool CSiaFileStore::Find(const std::string& siaPath, std::uint32_t& index) const
+{
+	if (!_pathSlotCount)
+	{
+		return false;
+	}
+
+	const std::size_t mask = _pathSlotCount - 1;
+	std::size_t slot = static_cast<std::size_t>(HashBytes(FNV_OFFSET_BASIS, siaPath.c_str(), siaPath.length())) & mask;
+	while (_pathSlotsData[slot] != EMPTY_PATH_SLOT)
+	{
+		if (PathEquals(_pathSlotsData[slot], siaPath))
+		{
+			index = _pathSlotsData[slot];
+			return true;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return false;
+}
+
+bool CSiaFileStore::Find(const SString& siaPath, std::uint32_t& index) const
+{
+	return Find(SString::ToUtf8(siaPath.str()), index);
+}
+
+// An exact match wins; otherwise the file whose path differs only in case
+bool CSiaFileStore::FindIgnoreCase(const SString& siaPath, std::uint32_t& index) const
+{
+	if (Find(siaPath, index))
+	{
+		return true;
+	}
+
+	BuildFoldedIndex();
+	if (_foldedSlots.empty())
+	{
+		return false;
+	}
+
+	const std::wstring foldedPath = FoldCase(SString::ToUtf8(siaPath.str()));
+	const std::uint64_t hash = HashFolded(foldedPath);
+	const std::size_t mask = _foldedSlots.size() - 1;
+	std::size_t slot = static_cast<std::size_t>(hash) & mask;
+	while (_foldedSlots[slot] != EMPTY_PATH_SLOT)
+	{
+		const std::uint32_t candidate = _foldedSlots[slot];
+		if ((_foldedHashes[candidate] == hash) && (FoldCase(GetSiaPathUtf8(candidate)) == foldedPath))
+		{
+			index = candidate;
+			return true;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return false;
+}
+
+std::vector<std::pair<std::uint32_t, std::uint32_t>> CSiaFileStore::GetCaseCollisions() const
+{
+	BuildFoldedIndex();
+	return _caseCollisions;
+}
+
+std::string CSiaFileStore::GetSiaPathUtf8(const std::uint32_t& index) const
+{
+	std::string siaPath = GetDirectoryUtf8(_directoryIdsData[index]);
+	if (!siaPath.empty())
+	{
+		siaPath += '/';
+	}
+
+	return siaPath.append(&_nameArenaData[_nameOffsetsData[index]], _nameOffsetsData[index + 1] - _nameOffsetsData[index]);
+}
+
+SString CSiaFileStore::GetSiaPath(const std::uint32_t& index) const
+{
+	return GetSiaPathUtf8(index);
+}
+
+std::string CSiaFileStore::GetDirectoryUtf8(const std::uint32_t& directoryId) const
+{
+	return std::string(&_directoryArenaData[_directoryOffsetsData[directoryId]], _directoryOffsetsData[directoryId + 1] - _directoryOffsetsData[directoryId]);
+}
+
+std::size_t CSiaFileStore::GetMemoryUsage() const
+{
+	return sizeof(CSiaFileStore) +
+		_directoryArena.capacity() +
+		_nameArena.capacity() +
+		(_directoryOffsets.capacity() + _nameOffsets.capacity() + _directoryIds.capacity() + _pathSlots.capacity()) * sizeof(std::uint32_t) +
+		(_redundancy.capacity() + _uploadProgress.capacity() + _expiration.capacity()) * sizeof(std::uint32_t) +
+		_fileSizes.capacity() * sizeof(std::uint64_t) +
+		_flags.capacity() +
+		_foldedHashes.capacity() * sizeof(std::uint64_t) +
+		_foldedSlots.capacity() * sizeof(std::uint32_t) +
+		static_cast<std::size_t>(_mappedSize);
+}
+
+bool CSiaFileStore::IsMapped() const
+{
+	return (_mappedView != nullptr);
+}
+
+// Compares metadata columns only - callers match rows by path
+bool CSiaFileStore::RowEquals(const std::uint32_t& index, const CSiaFileStore& other, const std::uint32_t& otherIndex) const
+{
+	return (_fileSizesData[index] == other._fileSizesData[otherIndex]) &&
+		(_flagsData[index] == other._flagsData[otherIndex]) &&
+		(_redundancyData[index] == other._redundancyData[otherIndex]) &&
+		(_uploadProgressData[index] == other._uploadProgressData[otherIndex]) &&
+		(_expirationData[index] == other._expirationData[otherIndex]);
+}
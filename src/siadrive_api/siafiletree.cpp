@@ -1,12 +1,41 @@
 #include <siaapi.h>
-#include <regex>
+#include <unordered_set>
+#include <jsonarraystream.h>
+#include <singleflight.h>
+#include <globmatcher.h>
+#include <parallelfiledecoder.h>
+#include <siadriveconfig.h>
 
 using namespace Sia::Api;
 
+typedef std::pair<SiaCurlError, CSiaFileTreePtr> FileTreeResult;
+
+static SString CreateHostKey(const SiaHostConfig& hostConfig)
+{
+	return hostConfig.HostName + ":" + SString::FromUInt32(hostConfig.HostPort);
+}
+
+// Shared and snapshot trees outlive the requesting thread, so base them on a long-lived instance per host
+static const CSiaCurl& GetHostCurl(const SiaHostConfig& hostConfig)
+{
+	static std::mutex hostCurlMutex;
+	static std::unordered_map<SString, std::unique_ptr<CSiaCurl>> hostCurls;
+
+	std::lock_guard<std::mutex> l(hostCurlMutex);
+	auto& hostCurl = hostCurls[CreateHostKey(hostConfig)];
+	if (!hostCurl)
+	{
+		hostCurl.reset(new CSiaCurl(hostConfig));
+	}
+
+	return *hostCurl;
+}
+
 CSiaApi::_CSiaFileTree::_CSiaFileTree(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig) :
 	CSiaBase(siaCurl, siaDriveConfig)
 {
-	
+	std::shared_ptr<CSiaFileStore> fileStore(new CSiaFileStore());
+	SetFileStore(fileStore);
 }
 
 CSiaApi::_CSiaFileTree::~_CSiaFileTree()
@@ -14,102 +43,355 @@ CSiaApi::_CSiaFileTree::~_CSiaFileTree()
 	
 }
 
+void CSiaApi::_CSiaFileTree::SetFileStore(std::shared_ptr<CSiaFileStore> fileStore)
+{
+	fileStore->Seal();
+
+	// Directory key (no leading or trailing '/', root is empty) -> immediate child directories. Interned
+	//	directories are walked instead of files, registering each ancestor once.
+	std::unordered_map<SString, std::vector<SString>> childDirectories;
+	std::unordered_map<SString, std::uint32_t> directoryIds;
+	std::unordered_set<SString> knownDirectories;
+	for (std::uint32_t id = 0; id < fileStore->GetDirectoryCount(); id++)
+	{
+		SString directory = fileStore->GetDirectoryUtf8(id);
+		directoryIds.insert({ directory, id });
+
+		while (directory.Length() && knownDirectories.insert(directory).second)
+		{
+			const size_t idx = directory.str().find_last_of('/');
+			const SString parent = (idx == SString::String::npos) ? SString() : directory.SubString(0, idx);
+			childDirectories[parent].push_back((idx == SString::String::npos) ? directory : directory.SubString(idx + 1));
+			directory = parent;
+		}
+	}
+
+	std::vector<std::vector<std::uint32_t>> childFiles(fileStore->GetDirectoryCount());
+	for (std::uint32_t i = 0; i < fileStore->GetCount(); i++)
+	{
+		childFiles[fileStore->GetDirectoryId(i)].push_back(i);
+	}
+
+	_childDirectories = std::move(childDirectories);
+	_directoryIds = std::move(directoryIds);
+	_childFiles = std::move(childFiles);
+	_fileStore = fileStore;
+}
+
+SString CSiaApi::_CSiaFileTree::FormatToDirectoryKey(SString directory)
+{
+	directory = CSiaApi::FormatToSiaPath(directory);
+	while (directory.Length() && (directory[directory.Length() - 1] == '/'))
+	{
+		directory = directory.SubString(0, directory.Length() - 1);
+	}
+
+	return directory;
+}
+
 void CSiaApi::_CSiaFileTree::BuildTree(const json& result)
 {
-  CSiaFileCollectionPtr fileList(new CSiaFileCollection());
+	std::shared_ptr<CSiaFileStore> fileStore(new CSiaFileStore());
 	for (const auto& file : result["files"])
 	{
-		fileList->push_back(CSiaFilePtr(new CSiaFile(GetSiaCurl(), &GetSiaDriveConfig(), file)));
+		fileStore->Add(file);
 	}
 
-  _fileList = fileList;
+	SetFileStore(fileStore);
 }
 
-bool CSiaApi::_CSiaFileTree::FileExists(const SString& siaPath) const
+SiaCurlError CSiaApi::_CSiaFileTree::BuildTree(const CSiaCurl& siaCurl)
 {
-  auto fileList = GetFileList();
-	auto result = std::find_if(fileList->begin(), fileList->end(), [&](const CSiaFilePtr& item)->bool
+	// Stream /renter/files - entries are split out as they arrive and decoded in parallel instead of
+	//	parsing the full response
+	CParallelFileDecoder fileDecoder;
+	CJsonArrayStream fileStream("files", nullptr);
+	fileStream.SetRawElementCallback([&](std::string& element)
+	{
+		fileDecoder.Push(element);
+	});
+
+	SiaCurlError ret = siaCurl.GetStream(L"/renter/files", {}, [&](const char* buffer, const size_t& length) -> bool
 	{
-		return (item->GetSiaPath() == siaPath);
+		return fileStream.Feed(buffer, length);
 	});
 
-	return (result != fileList->end());
+	if (ApiSuccess(ret))
+	{
+		std::shared_ptr<CSiaFileStore> fileStore(new CSiaFileStore());
+		if (!fileDecoder.Finish(*fileStore))
+		{
+			ret = { SiaCurlErrorCode::UnknownFailure, "Invalid /renter/files entry" };
+		}
+		else if (fileStream.IsComplete())
+		{
+			SetFileStore(fileStore);
+		}
+		else
+		{
+			ret = { SiaCurlErrorCode::UnknownFailure, "Incomplete /renter/files response" };
+		}
+	}
+
+	return ret;
 }
 
-CSiaFileCollectionPtr CSiaApi::_CSiaFileTree::GetFileList() const
+SiaCurlError CSiaApi::_CSiaFileTree::FetchShared(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, CSiaFileTreePtr& fileTree, const bool& force)
 {
-	return _fileList;
+	static CSingleFlight<FileTreeResult> fileTreeFlight;
+
+	const SString hostKey = CreateHostKey(siaCurl.GetHostConfig());
+	if (force)
+	{
+		fileTreeFlight.Forget(hostKey);
+	}
+
+	FileTreeResult result = fileTreeFlight.Do(hostKey, siaDriveConfig->GetFileTreeFreshnessMs(), [&](bool& shareable) -> FileTreeResult
+	{
+		CSiaFileTreePtr sharedTree(new CSiaFileTree(GetHostCurl(siaCurl.GetHostConfig()), siaDriveConfig));
+		SiaCurlError cerror = sharedTree->BuildTree(siaCurl);
+		shareable = ApiSuccess(cerror);
+		return { cerror, shareable ? sharedTree : nullptr };
+	});
+
+	if (ApiSuccess(result.first))
+	{
+		fileTree = result.second;
+	}
+
+	return result.first;
 }
 
-CSiaFilePtr CSiaApi::_CSiaFileTree::GetFile(const SString& siaPath) const
+// Snapshots are tagged with the host they were taken from - a snapshot from another siad is never served
+bool CSiaApi::_CSiaFileTree::LoadSnapshot(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, CSiaFileTreePtr& fileTree)
 {
-  auto fileList = GetFileList();
-	auto result = std::find_if(fileList->begin(), fileList->end(), [&](const CSiaFilePtr& item)->bool
+	const SString filePath = siaDriveConfig->GetRenter_FileTreeSnapshotFilePath();
+	if (filePath.IsNullOrEmpty())
 	{
-		return (item->GetSiaPath() == siaPath);
-	});
-	
-	return ((result != fileList->end()) ? *result : nullptr);
+		return false;
+	}
+
+	auto fileStore = CSiaFileStore::LoadSnapshot(filePath, SString::ToUtf8(CreateHostKey(siaCurl.GetHostConfig()).str()));
+	if (fileStore)
+	{
+		fileTree.reset(new CSiaFileTree(GetHostCurl(siaCurl.GetHostConfig()), siaDriveConfig));
+		fileTree->SetFileStore(fileStore);
+	}
+
+	return (fileStore != nullptr);
 }
 
-CSiaFileCollection CSiaApi::_CSiaFileTree::Query(SString query) const
+bool CSiaApi::_CSiaFileTree::SaveSnapshot() const
 {
-  auto fileList = GetFileList();
-	query = CSiaApi::FormatToSiaPath(query);
-	query.Replace(".", "\\.").Replace("*", "[^/]+").Replace("?", "[^/]?");
-	std::wregex r(query.str());
+	const SString filePath = GetSiaDriveConfig().GetRenter_FileTreeSnapshotFilePath();
+	return !filePath.IsNullOrEmpty() && _fileStore->SaveSnapshot(filePath, SString::ToUtf8(CreateHostKey(GetSiaCurl().GetHostConfig()).str()));
+}
 
-	CSiaFileCollection ret;
-	std::copy_if(fileList->begin(), fileList->end(), std::back_inserter(ret), [&](const CSiaFilePtr& v) -> bool
+bool CSiaApi::_CSiaFileTree::IsSnapshot() const
+{
+	return _fileStore->IsMapped();
+}
+
+bool CSiaApi::_CSiaFileTree::FileExists(const SString& siaPath) const
+{
+	std::uint32_t index;
+	return _fileStore->Find(siaPath, index);
+}
+
+// Windows callers may use any casing - resolves to the path as it's stored on Sia
+bool CSiaApi::_CSiaFileTree::FileExistsIgnoreCase(const SString& siaPath, SString& resolvedSiaPath) const
+{
+	std::uint32_t index;
+	const bool ret = _fileStore->FindIgnoreCase(siaPath, index);
+	if (ret)
+	{
+		resolvedSiaPath = _fileStore->GetSiaPath(index);
+	}
+
+	return ret;
+}
+
+CSiaFileStorePtr CSiaApi::_CSiaFileTree::GetFileStore() const
+{
+	return _fileStore;
+}
+
+// Views are only materialized on request - scans should prefer GetFileStore()
+CSiaFileCollectionPtr CSiaApi::_CSiaFileTree::GetFileList() const
+{
+	std::call_once(_fileListOnce, [this]()
 	{
-		return std::regex_match(v->GetSiaPath().str(), r);
+		CSiaFileCollectionPtr fileList(new CSiaFileCollection());
+		fileList->reserve(_fileStore->GetCount());
+		for (std::uint32_t i = 0; i < _fileStore->GetCount(); i++)
+		{
+			fileList->push_back(CSiaFilePtr(new CSiaFile(_fileStore, i)));
+		}
+		_fileList = fileList;
 	});
 
-	return std::move(ret);
+	return _fileList;
 }
 
-std::vector<SString> CSiaApi::_CSiaFileTree::QueryDirectories(SString rootFolder) const
+CSiaFilePtr CSiaApi::_CSiaFileTree::GetFile(const SString& siaPath) const
+{
+	std::uint32_t index;
+	return (_fileStore->Find(siaPath, index) ? CSiaFilePtr(new CSiaFile(_fileStore, index)) : nullptr);
+}
+
+CSiaFilePtr CSiaApi::_CSiaFileTree::GetFileIgnoreCase(const SString& siaPath) const
 {
-  auto fileList = GetFileList();
-	CSiaFileCollection col;
-	rootFolder.Replace("/", "\\");
-	if (rootFolder[0] == '\\')
+	std::uint32_t index;
+	return (_fileStore->FindIgnoreCase(siaPath, index) ? CSiaFilePtr(new CSiaFile(_fileStore, index)) : nullptr);
+}
+
+// Paths that differ only in case - only the first one listed is reachable through the drive
+std::vector<CEventPtr> CSiaApi::_CSiaFileTree::GetCaseCollisions() const
+{
+	std::vector<CEventPtr> ret;
+	for (const auto& collision : _fileStore->GetCaseCollisions())
 	{
-		rootFolder = rootFolder.SubString(1);
+		ret.push_back(CreateSystemEvent(SiaFileCaseCollision(_fileStore->GetSiaPath(collision.first), _fileStore->GetSiaPath(collision.second))));
 	}
 
-	std::vector<SString> ret;
-	std::for_each(fileList->begin(), fileList->end(), [&](const CSiaFilePtr& v)
+	return ret;
+}
+
+// Changes since 'previous', keyed by sia path. Both stores are hash indexed, so cost is linear in the
+//	size of the two snapshots. Optionally reports every differing row as (current, previous) index, using
+//	CSiaFileStore::NoIndex for the side a file is missing from.
+std::vector<CEventPtr> CSiaApi::_CSiaFileTree::Diff(const _CSiaFileTree& previous, std::vector<std::pair<std::uint32_t, std::uint32_t>>* changedRows) const
+{
+	const CSiaFileStore& current = *_fileStore;
+	const CSiaFileStore& prior = *previous._fileStore;
+
+	std::vector<CEventPtr> ret;
+	for (std::uint32_t i = 0; i < current.GetCount(); i++)
 	{
-		SString dir = v->GetSiaPath();
-		dir.Replace("/", "\\");
-		::PathRemoveFileSpec(&dir[0]);
-		::PathRemoveBackslash(&dir[0]);
-		::PathRemoveBackslash(&rootFolder[0]);
-		dir = dir.str().c_str();
-		rootFolder = rootFolder.str().c_str();
-		if ((dir.Length() > rootFolder.Length()) && (dir.SubString(0, rootFolder.Length()) == rootFolder))
+		const std::string siaPath = current.GetSiaPathUtf8(i);
+		std::uint32_t j;
+		if (!prior.Find(siaPath, j))
+		{
+			ret.push_back(CreateSystemEvent(SiaFileAdded(siaPath, current.GetFileSize(i))));
+			if (changedRows)
+			{
+				changedRows->push_back({ i, CSiaFileStore::NoIndex });
+			}
+		}
+		else
 		{
-			SString subFolder = dir.SubString(rootFolder.Length());
-			int idx = subFolder.str().find('\\');
-			if (idx == 0)
+			if (changedRows && !current.RowEquals(i, prior, j))
+			{
+				changedRows->push_back({ i, j });
+			}
+
+			if (prior.GetFileSize(j) != current.GetFileSize(i))
 			{
-				subFolder = subFolder.SubString(1);
-				idx = subFolder.str().find('\\');
+				ret.push_back(CreateSystemEvent(SiaFileSizeChanged(siaPath, prior.GetFileSize(j), current.GetFileSize(i))));
 			}
 
-			if (idx > 0)
+			if (prior.GetAvailable(j) != current.GetAvailable(i))
 			{
-				subFolder = subFolder.SubString(0, idx);
+				ret.push_back(CreateSystemEvent(SiaFileAvailabilityChanged(siaPath, current.GetAvailable(i))));
 			}
 
-			auto it = std::find(ret.begin(), ret.end(), subFolder);
-			if (it == ret.end())
+			if (prior.GetUploadProgress(j) != current.GetUploadProgress(i))
 			{
-				ret.push_back(subFolder);
+				ret.push_back(CreateSystemEvent(SiaFileUploadProgressChanged(siaPath, prior.GetUploadProgress(j), current.GetUploadProgress(i))));
 			}
 		}
+	}
+
+	for (std::uint32_t j = 0; j < prior.GetCount(); j++)
+	{
+		const std::string siaPath = prior.GetSiaPathUtf8(j);
+		std::uint32_t i;
+		if (!current.Find(siaPath, i))
+		{
+			ret.push_back(CreateSystemEvent(SiaFileRemoved(siaPath)));
+			if (changedRows)
+			{
+				changedRows->push_back({ CSiaFileStore::NoIndex, j });
+			}
+		}
+	}
+
+	return std::move(ret);
+}
+
+// Directories that differ only in case resolve to the one stored on Sia; unknown directories are returned
+//	unchanged
+SString CSiaApi::_CSiaFileTree::ResolveDirectory(const SString& directory) const
+{
+	if ((_directoryIds.find(directory) != _directoryIds.end()) || (_childDirectories.find(directory) != _childDirectories.end()))
+	{
+		return directory;
+	}
+
+	std::call_once(_foldedDirectoriesOnce, [this]()
+	{
+		for (const auto& kv : _directoryIds)
+		{
+			_foldedDirectories.insert({ CSiaFileStore::FoldCase(SString::ToUtf8(kv.first.str())), kv.first });
+		}
+		for (const auto& kv : _childDirectories)
+		{
+			_foldedDirectories.insert({ CSiaFileStore::FoldCase(SString::ToUtf8(kv.first.str())), kv.first });
+		}
 	});
 
+	auto it = _foldedDirectories.find(CSiaFileStore::FoldCase(SString::ToUtf8(directory.str())));
+	return ((it == _foldedDirectories.end()) ? directory : it->second);
+}
+
+CSiaFileCollection CSiaApi::_CSiaFileTree::Query(SString query) const
+{
+	query = CSiaApi::FormatToSiaPath(query);
+
+	// Wildcards only match within a single path segment, so a literal parent directory limits candidates
+	//	to that directory's files
+	const size_t idx = query.str().find_last_of('/');
+	SString directory = (idx == SString::String::npos) ? SString() : query.SubString(0, idx);
+	const bool useDirectory = (directory.str().find_first_of(L"*?") == SString::String::npos);
+	if (useDirectory && (idx != SString::String::npos))
+	{
+		// Matching is case-sensitive, so match against the directory as it's stored on Sia
+		directory = ResolveDirectory(directory);
+		query = directory + query.SubString(idx);
+	}
+
+	CGlobMatcherPtr matcher = CGlobMatcher::Get(query);
+
+	CSiaFileCollection ret;
+	auto matchFile = [&](const std::uint32_t& index)
+	{
+		if (matcher->IsMatch(_fileStore->GetSiaPath(index)))
+		{
+			ret.push_back(CSiaFilePtr(new CSiaFile(_fileStore, index)));
+		}
+	};
+
+	if (useDirectory)
+	{
+		auto it = _directoryIds.find(directory);
+		if (it != _directoryIds.end())
+		{
+			std::for_each(_childFiles[it->second].begin(), _childFiles[it->second].end(), matchFile);
+		}
+	}
+	else
+	{
+		for (std::uint32_t i = 0; i < _fileStore->GetCount(); i++)
+		{
+			matchFile(i);
+		}
+	}
+
 	return std::move(ret);
+}
+
+std::vector<SString> CSiaApi::_CSiaFileTree::QueryDirectories(SString rootFolder) const
+{
+	auto it = _childDirectories.find(ResolveDirectory(FormatToDirectoryKey(rootFolder)));
+	return ((it != _childDirectories.end()) ? it->second : std::vector<SString>());
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <siaapi.h>
 #include <SQLiteCpp/Database.h>
+#include <siadriveconfig.h>
 
 using namespace Sia::Api;
+
+#define FILE_TREE_SNAPSHOT_INTERVAL_SECS 30
 /*{
   // Settings that control the behavior of the renter.
   "settings": {
@@ -53,9 +56,12 @@ CSiaApi::_CSiaRenter::_CSiaRenter(const CSiaCurl& siaCurl, CSiaDriveConfig* siaD
 	_Unspent(0),
 	_TotalUsedBytes(0),
 	_TotalUploadProgress(100),
+	_PendingUploadBytes(0),
+	_UnavailableFileCount(0),
   _Period(0),
   _RenewWindow(0),
-  _currentAllowance({ 0,0,0,0 })
+  _currentAllowance({ 0,0,0,0 }),
+  _fileTreeSnapshotDirty(false)
 {
 }
 
@@ -87,37 +93,21 @@ void CSiaApi::_CSiaRenter::Refresh(const CSiaCurl& siaCurl, CSiaDriveConfig* sia
       _currentAllowance.Period = SIA_DEFAULT_CONTRACT_LENGTH;
       _currentAllowance.RenewWindowInBlocks = SIA_DEFAULT_RENEW_WINDOW;
     }
+		// Totals are maintained as the file tree changes
 		if (ApiSuccess(RefreshFileTree()))
-    {
-      CSiaFileTreePtr fileTree;
-      GetFileTree(fileTree);
-
-			auto fileList = fileTree->GetFileList();
-			if (fileList->size())
-			{
-				std::uint64_t total = std::accumulate(std::next(fileList->begin()), fileList->end(), fileList->at(0)->GetFileSize(), [](const std::uint64_t& sz, const CSiaFilePtr& file)
-				{
-					return sz + file->GetFileSize();
-				});
-
-				std::uint32_t totalProgress = std::accumulate(std::next(fileList->begin()), fileList->end(), fileList->at(0)->GetUploadProgress(), [](const std::uint32_t& progress, const CSiaFilePtr& file)
-				{
-					return progress + min(100, file->GetUploadProgress());
-				}) / static_cast<std::uint32_t>(fileList->size());
-
-				SetTotalUsedBytes(total);
-				SetTotalUploadProgress(totalProgress);
-			}
-			else
-			{
-				SetTotalUsedBytes(0);
-				SetTotalUploadProgress(100);
-			}
+		{
+			const std::uint64_t fileCount = _fileAggregates.GetFileCount();
+			SetTotalUsedBytes(_fileAggregates.Get(CSiaFileAggregates::TotalUsedBytes));
+			SetTotalUploadProgress(fileCount ? static_cast<std::uint32_t>(_fileAggregates.Get(CSiaFileAggregates::TotalUploadProgress) / fileCount) : 100);
+			SetPendingUploadBytes(_fileAggregates.Get(CSiaFileAggregates::PendingUploadBytes));
+			SetUnavailableFileCount(_fileAggregates.Get(CSiaFileAggregates::UnavailableFileCount));
 		}
 		else
 		{
 			SetTotalUsedBytes(0);
 			SetTotalUploadProgress(100);
+			SetPendingUploadBytes(0);
+			SetUnavailableFileCount(0);
 		}
 	}
 	else
@@ -127,24 +117,75 @@ void CSiaApi::_CSiaRenter::Refresh(const CSiaCurl& siaCurl, CSiaDriveConfig* sia
 		SetUnspent(0);
 		SetTotalUsedBytes(0);
 		SetTotalUploadProgress(100);
+		SetPendingUploadBytes(0);
+		SetUnavailableFileCount(0);
     SetPeriod(0);
     SetRenewWindow(0);
     _currentAllowance = { 0,0,0,0 };
 	}
 }
 
-SiaApiError CSiaApi::_CSiaRenter::RefreshFileTree( )
+SiaApiError CSiaApi::_CSiaRenter::RefreshFileTree(const bool& force)
 {
   SiaApiError ret;
-  CSiaFileTreePtr tempTree(new CSiaFileTree(GetSiaCurl(), &GetSiaDriveConfig()));
-  json result;  
-  SiaCurlError cerror = GetSiaCurl().Get(L"/renter/files", result);
+  // Serialize refreshes so published diffs always move forward from the active tree
+  std::lock_guard<std::mutex> r(_fileTreeRefreshMutex);
+  CSiaFileTreePtr tempTree;
+  SiaCurlError cerror = CSiaFileTree::FetchShared(GetSiaCurl(), &GetSiaDriveConfig(), tempTree, force);
   if (ApiSuccess(cerror))
   {
-    tempTree->BuildTree(result);
+    // Coalesced fetches may return the active tree - only publish a new version
+    CSiaFileTreePtr previousTree = _fileTree.Load();
+    bool filesAdded = !previousTree;
+    if (previousTree != tempTree)
+    {
+      _fileTree.Store(tempTree);
+    }
+
+    // The first tree is the baseline - only changes after it are published
+    if (previousTree && (previousTree != tempTree))
+    {
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> changedRows;
+      auto changes = tempTree->Diff(*previousTree, &changedRows);
+      _fileAggregates.Apply(tempTree->GetFileStore(), *previousTree->GetFileStore(), changedRows);
+      for (auto& evt : changes)
+      {
+        filesAdded = filesAdded || (std::dynamic_pointer_cast<SiaFileAdded>(evt) != nullptr);
+        CEventSystem::EventSystem.NotifyEvent(evt);
+      }
+      _fileTreeSnapshotDirty = _fileTreeSnapshotDirty || !changes.empty() || previousTree->IsSnapshot();
+    }
+    else if (!previousTree)
+    {
+      _fileAggregates.Reset(tempTree->GetFileStore());
+      _fileTreeSnapshotDirty = true;
+    }
+
+    // Case collisions can't be represented on a Windows drive - report each one once. New collisions
+    //	require a new path, so the folded index is only built when files were added.
+    if ((previousTree != tempTree) && filesAdded)
     {
-      std::lock_guard<std::mutex> l(_fileTreeMutex);
-      _fileTree = tempTree;
+      std::unordered_set<std::wstring> reported;
+      for (const auto& evt : tempTree->GetCaseCollisions())
+      {
+        const std::wstring message = evt->GetSingleLineMessage().str();
+        if (_reportedCaseCollisions.find(message) == _reportedCaseCollisions.end())
+        {
+          CEventSystem::EventSystem.NotifyEvent(evt);
+        }
+        reported.insert(message);
+      }
+      _reportedCaseCollisions = std::move(reported);
+    }
+
+    previousTree.reset();
+
+    // Persist for the next start, at most once per interval - a failed write (snapshot still mapped) is retried later
+    const auto now = std::chrono::steady_clock::now();
+    if (_fileTreeSnapshotDirty && (now - _fileTreeSnapshotAttempted >= std::chrono::seconds(FILE_TREE_SNAPSHOT_INTERVAL_SECS)))
+    {
+      _fileTreeSnapshotAttempted = now;
+      _fileTreeSnapshotDirty = !tempTree->SaveSnapshot();
     }
   }
   else
@@ -155,6 +196,42 @@ SiaApiError CSiaApi::_CSiaRenter::RefreshFileTree( )
   return ret;
 }
 
+// Serves the last persisted tree until the first refresh from siad replaces it
+bool CSiaApi::_CSiaRenter::LoadFileTreeSnapshot()
+{
+  CSiaFileTreePtr snapshotTree;
+  bool ret = CSiaFileTree::LoadSnapshot(GetSiaCurl(), &GetSiaDriveConfig(), snapshotTree);
+  if (ret)
+  {
+    // Never replace a tree already fetched from siad
+    std::lock_guard<std::mutex> l(_fileTreeRefreshMutex);
+    CSiaFileTreePtr expected;
+    ret = _fileTree.CompareExchange(expected, snapshotTree);
+    if (ret)
+    {
+      _fileAggregates.Reset(snapshotTree->GetFileStore());
+    }
+  }
+
+  return ret;
+}
+
+bool CSiaApi::_CSiaRenter::RegisterAggregate(const SString& name, CSiaFileAggregates::Contribution contribution)
+{
+  return _fileAggregates.Register(name, contribution);
+}
+
+std::int64_t CSiaApi::_CSiaRenter::GetAggregate(const SString& name) const
+{
+  return _fileAggregates.Get(name);
+}
+
+// Bytes in files whose contracts end before 'blockHeight' - pass current height + N for an N block window
+std::uint64_t CSiaApi::_CSiaRenter::GetBytesExpiringBefore(const std::uint64_t& blockHeight) const
+{
+  return _fileAggregates.GetBytesExpiringBefore(blockHeight);
+}
+
 SiaApiError CSiaApi::_CSiaRenter::FileExists(const SString& siaPath, bool& exists) const
 {
 	CSiaFileTreePtr siaFileTree;
@@ -167,6 +244,18 @@ SiaApiError CSiaApi::_CSiaRenter::FileExists(const SString& siaPath, bool& exist
 	return ret;
 }
 
+SiaApiError CSiaApi::_CSiaRenter::FileExistsIgnoreCase(const SString& siaPath, bool& exists, SString& resolvedSiaPath) const
+{
+	CSiaFileTreePtr siaFileTree;
+	SiaApiError ret = GetFileTree(siaFileTree);
+	if (ApiSuccess(ret))
+	{
+		exists = siaFileTree->FileExistsIgnoreCase(siaPath, resolvedSiaPath);
+	}
+
+	return ret;
+}
+
 SiaApiError CSiaApi::_CSiaRenter::DownloadFile(const SString& siaPath, const SString& location) const
 {
   SiaApiError ret;
@@ -182,7 +271,7 @@ SiaApiError CSiaApi::_CSiaRenter::DownloadFile(const SString& siaPath, const SSt
 
 SiaApiError CSiaApi::_CSiaRenter::GetFileTree(CSiaFileTreePtr& siaFileTree) const
 {
-  siaFileTree = _fileTree;
+  siaFileTree = _fileTree.Load();
   if (!siaFileTree)
   {
     siaFileTree.reset(new CSiaFileTree(GetSiaCurl(), &GetSiaDriveConfig()));
@@ -0,0 +1,305 @@
+#include <uploadbundler.h>
+
+using namespace Sia::Api;
+
+#define CREATE_BUNDLE_TABLE "create table if not exists bundle_table (id integer primary key autoincrement, sia_path text unique, file_path text not null, size integer not null default 0, live_bytes integer not null default 0, status integer not null, created_time integer not null, replaced_by integer not null default 0);"
+#define CREATE_MEMBER_TABLE "create table if not exists bundle_member_table (sia_path text primary key not null, bundle_id integer not null, member_offset integer not null, member_length integer not null);"
+#define CREATE_MEMBER_INDEX "create index if not exists bundle_member_table_bundle_idx on bundle_member_table (bundle_id);"
+#define QUERY_BUNDLE_BY_STATUS "select * from bundle_table where status=@status order by id asc limit 1;"
+#define INSERT_BUNDLE "insert into bundle_table (file_path, status, created_time) values ('', @status, @created_time);"
+#define UPDATE_BUNDLE_PATHS "update bundle_table set sia_path=@sia_path, file_path=@file_path where id=@id;"
+#define ADD_BUNDLE_BYTES "update bundle_table set size=@size, live_bytes=live_bytes + @length where id=@id;"
+#define REMOVE_BUNDLE_BYTES "update bundle_table set live_bytes=live_bytes - @length where id=@id;"
+#define UPDATE_BUNDLE_STATUS "update bundle_table set status=@status where id=@id;"
+#define RETIRE_BUNDLE "update bundle_table set status=@status, replaced_by=@replaced_by where id=@id;"
+#define DELETE_BUNDLE "delete from bundle_table where id=@id;"
+#define QUERY_MEMBER "select m.member_offset, m.member_length, b.* from bundle_member_table m join bundle_table b on b.id=m.bundle_id where m.sia_path=@sia_path;"
+#define QUERY_ALL_MEMBERS "select sia_path from bundle_member_table;"
+#define QUERY_BUNDLE_MEMBERS "select * from bundle_member_table where bundle_id=@bundle_id;"
+#define INSERT_MEMBER "insert or replace into bundle_member_table (sia_path, bundle_id, member_offset, member_length) values (@sia_path, @bundle_id, @member_offset, @member_length);"
+#define DELETE_MEMBER "delete from bundle_member_table where sia_path=@sia_path;"
+// Bundles are uploaded through upload_table - only compact once the upload has finished
+#define QUERY_COMPACTION_CANDIDATE "select b.* from bundle_table b join upload_table u on u.sia_path=b.sia_path where b.status=@status and u.status=@upload_status and b.live_bytes * 100 < b.size * (100 - @stale_percent) order by b.live_bytes * 1.0 / b.size asc limit 1;"
+// Retired bundles stay on Sia until the bundle their members moved to has finished uploading
+#define QUERY_RETIRED_BUNDLE "select r.* from bundle_table r where r.status=@status and not exists (select 1 from bundle_table t where t.id=r.replaced_by and not exists (select 1 from upload_table u where u.sia_path=t.sia_path and u.status=@upload_status)) order by r.id asc limit 1;"
+
+const SString CUploadBundler::BundleSiaFolder = L".siadrive/bundles";
+
+static std::int64_t GetEpochSeconds()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+CUploadBundler::CUploadBundler(SQLite::Database& database, const SString& bundleFolder) :
+	_database(database),
+	_bundleFolder(bundleFolder)
+{
+	_database.exec(CREATE_BUNDLE_TABLE);
+	_database.exec(CREATE_MEMBER_TABLE);
+	_database.exec(CREATE_MEMBER_INDEX);
+
+	SQLite::Statement query(_database, QUERY_ALL_MEMBERS);
+	while (query.executeStep())
+	{
+		_memberPaths.insert(SString(static_cast<const char*>(query.getColumn(0))).str());
+	}
+}
+
+CUploadBundler::~CUploadBundler()
+{
+}
+
+// True for bundle objects and the folders holding them - these are never shown on the drive
+bool CUploadBundler::IsBundlePath(const SString& siaPath)
+{
+	return (siaPath == BundleSiaFolder) || siaPath.BeginsWith(BundleSiaFolder + L"/") || BundleSiaFolder.BeginsWith(siaPath + L"/");
+}
+
+// Appends 'length' bytes of the source, starting at 'offset', to the end of the destination. 'destOffset'
+//	receives where they were written - a failed copy may leave a partial tail behind, which is never referenced.
+bool CUploadBundler::CopyFileRange(const SString& sourcePath, const std::uint64_t& offset, const std::uint64_t& length, const SString& destPath, std::uint64_t& destOffset)
+{
+	bool ret = false;
+#ifdef _WIN32
+	HANDLE source = ::CreateFile(sourcePath.str().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	HANDLE dest = ::CreateFile(destPath.str().c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, 0, nullptr);
+	if ((source != INVALID_HANDLE_VALUE) && (dest != INVALID_HANDLE_VALUE))
+	{
+		LARGE_INTEGER sourcePos = { 0 };
+		sourcePos.QuadPart = offset;
+		LARGE_INTEGER destStart = { 0 };
+		LARGE_INTEGER destEnd = { 0 };
+		ret = ::SetFilePointerEx(source, sourcePos, nullptr, FILE_BEGIN) && ::SetFilePointerEx(dest, destStart, &destEnd, FILE_END);
+		destOffset = destEnd.QuadPart;
+
+		std::vector<BYTE> buffer(1024 * 1024);
+		std::uint64_t remaining = length;
+		while (ret && remaining)
+		{
+			const DWORD toRead = static_cast<DWORD>((remaining < buffer.size()) ? remaining : buffer.size());
+			DWORD bytesRead = 0;
+			DWORD bytesWritten = 0;
+			ret = ::ReadFile(source, &buffer[0], toRead, &bytesRead, nullptr) && (bytesRead == toRead) &&
+				::WriteFile(dest, &buffer[0], bytesRead, &bytesWritten, nullptr) && (bytesWritten == bytesRead);
+			remaining -= bytesRead;
+		}
+	}
+
+	if (source != INVALID_HANDLE_VALUE) ::CloseHandle(source);
+	if (dest != INVALID_HANDLE_VALUE) ::CloseHandle(dest);
+#else
+	a
+#endif
+
+	return ret;
+}
+
+bool CUploadBundler::ExtractMember(const MemberData& member, const SString& destPath)
+{
+	std::uint64_t destOffset;
+	FilePath(destPath).DeleteFile();
+	return CopyFileRange(member.Bundle.FilePath, member.Offset, member.Length, destPath, destOffset);
+}
+
+bool CUploadBundler::ReadBundle(SQLite::Statement& query, BundleData& bundle)
+{
+	const bool ret = query.executeStep();
+	if (ret)
+	{
+		bundle.Id = query.getColumn(query.getColumnIndex("id")).getInt64();
+		bundle.SiaPath = static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path")));
+		bundle.FilePath = static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path")));
+		bundle.Size = query.getColumn(query.getColumnIndex("size")).getInt64();
+		bundle.LiveBytes = query.getColumn(query.getColumnIndex("live_bytes")).getInt64();
+	}
+
+	return ret;
+}
+
+// Only one bundle is open for appending at a time - a new one is started once it's sealed
+bool CUploadBundler::GetOpenBundle(BundleData& bundle)
+{
+	{
+		SQLite::Statement query(_database, QUERY_BUNDLE_BY_STATUS);
+		query.bind("@status", static_cast<unsigned>(BundleStatus::Open));
+		if (ReadBundle(query, bundle))
+		{
+			return true;
+		}
+	}
+
+	if (!_bundleFolder.IsDirectory() && !_bundleFolder.CreateDirectory())
+	{
+		return false;
+	}
+
+	SQLite::Statement insert(_database, INSERT_BUNDLE);
+	insert.bind("@status", static_cast<unsigned>(BundleStatus::Open));
+	insert.bind("@created_time", static_cast<long long>(GetEpochSeconds()));
+	insert.exec();
+
+	bundle.Id = _database.getLastInsertRowid();
+	bundle.SiaPath = BundleSiaFolder + L"/" + SString::FromInt64(bundle.Id) + L".bundle";
+	bundle.FilePath = FilePath(_bundleFolder, SString::FromInt64(bundle.Id) + L".bundle");
+	bundle.Size = 0;
+	bundle.LiveBytes = 0;
+
+	SQLite::Statement update(_database, UPDATE_BUNDLE_PATHS);
+	update.bind("@sia_path", SString::ToUtf8(bundle.SiaPath).c_str());
+	update.bind("@file_path", SString::ToUtf8(bundle.FilePath).c_str());
+	update.bind("@id", static_cast<long long>(bundle.Id));
+	return (update.exec() == 1);
+}
+
+// Records a member already copied into 'bundle' at 'offset', replacing any earlier copy of it
+bool CUploadBundler::Pack(const SString& siaPath, const std::uint64_t& offset, const std::uint64_t& length, BundleData& bundle)
+{
+	RemoveMember(siaPath);
+
+	SQLite::Statement insert(_database, INSERT_MEMBER);
+	insert.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+	insert.bind("@bundle_id", static_cast<long long>(bundle.Id));
+	insert.bind("@member_offset", static_cast<long long>(offset));
+	insert.bind("@member_length", static_cast<long long>(length));
+	insert.exec();
+
+	bundle.Size = (offset + length > bundle.Size) ? offset + length : bundle.Size;
+	bundle.LiveBytes += length;
+	SQLite::Statement update(_database, ADD_BUNDLE_BYTES);
+	update.bind("@size", static_cast<long long>(bundle.Size));
+	update.bind("@length", static_cast<long long>(length));
+	update.bind("@id", static_cast<long long>(bundle.Id));
+	const bool ret = (update.exec() == 1);
+
+	std::lock_guard<std::mutex> l(_memberMutex);
+	_memberPaths.insert(siaPath.str());
+	return ret;
+}
+
+// The member's bytes stay in the bundle as stale data until it's compacted
+bool CUploadBundler::RemoveMember(const SString& siaPath)
+{
+	MemberData member;
+	const bool ret = GetMember(siaPath, member);
+	if (ret)
+	{
+		SQLite::Statement del(_database, DELETE_MEMBER);
+		del.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+		del.exec();
+
+		SQLite::Statement update(_database, REMOVE_BUNDLE_BYTES);
+		update.bind("@length", static_cast<long long>(member.Length));
+		update.bind("@id", static_cast<long long>(member.Bundle.Id));
+		update.exec();
+
+		std::lock_guard<std::mutex> l(_memberMutex);
+		_memberPaths.erase(siaPath.str());
+	}
+
+	return ret;
+}
+
+bool CUploadBundler::GetMember(const SString& siaPath, MemberData& member)
+{
+	SQLite::Statement query(_database, QUERY_MEMBER);
+	query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+	const bool ret = ReadBundle(query, member.Bundle);
+	if (ret)
+	{
+		member.Offset = query.getColumn(query.getColumnIndex("member_offset")).getInt64();
+		member.Length = query.getColumn(query.getColumnIndex("member_length")).getInt64();
+	}
+
+	return ret;
+}
+
+// Safe to call without serializing database access
+bool CUploadBundler::IsMember(const SString& siaPath)
+{
+	std::lock_guard<std::mutex> l(_memberMutex);
+	return (_memberPaths.find(siaPath.str()) != _memberPaths.end());
+}
+
+// Seals the open bundle once it's full, or once it has waited long enough for more members
+bool CUploadBundler::SealIfReady(const std::uint64_t& targetBytes, const std::uint32_t& maxOpenSecs, BundleData& bundle)
+{
+	bool ret = false;
+	std::int64_t createdTime = 0;
+	{
+		SQLite::Statement query(_database, QUERY_BUNDLE_BY_STATUS);
+		query.bind("@status", static_cast<unsigned>(BundleStatus::Open));
+		ret = ReadBundle(query, bundle);
+		if (ret)
+		{
+			createdTime = query.getColumn(query.getColumnIndex("created_time")).getInt64();
+		}
+	}
+
+	ret = ret && bundle.Size && ((bundle.Size >= targetBytes) || (GetEpochSeconds() - createdTime >= maxOpenSecs));
+	if (ret)
+	{
+		SQLite::Statement update(_database, UPDATE_BUNDLE_STATUS);
+		update.bind("@status", static_cast<unsigned>(BundleStatus::Sealed));
+		update.bind("@id", static_cast<long long>(bundle.Id));
+		ret = (update.exec() == 1);
+	}
+
+	return ret;
+}
+
+bool CUploadBundler::GetCompactionCandidate(const std::uint8_t& stalePercent, const unsigned& uploadCompleteStatus, BundleData& bundle)
+{
+	SQLite::Statement query(_database, QUERY_COMPACTION_CANDIDATE);
+	query.bind("@status", static_cast<unsigned>(BundleStatus::Sealed));
+	query.bind("@upload_status", uploadCompleteStatus);
+	query.bind("@stale_percent", static_cast<unsigned>(stalePercent));
+	return ReadBundle(query, bundle);
+}
+
+std::vector<std::pair<SString, CUploadBundler::MemberData>> CUploadBundler::GetMembers(const BundleData& bundle)
+{
+	std::vector<std::pair<SString, MemberData>> ret;
+	SQLite::Statement query(_database, QUERY_BUNDLE_MEMBERS);
+	query.bind("@bundle_id", static_cast<long long>(bundle.Id));
+	while (query.executeStep())
+	{
+		ret.push_back({ static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path"))), { bundle, static_cast<std::uint64_t>(query.getColumn(query.getColumnIndex("member_offset")).getInt64()), static_cast<std::uint64_t>(query.getColumn(query.getColumnIndex("member_length")).getInt64()) } });
+	}
+
+	return ret;
+}
+
+// Called once the live members of a sealed bundle have been packed into 'replacedById' (0 if there were none).
+//	The local file is deleted, but the bundle stays on Sia until GetRetiredBundle() reports it.
+bool CUploadBundler::Retire(const BundleData& bundle, const std::int64_t& replacedById)
+{
+	SQLite::Statement update(_database, RETIRE_BUNDLE);
+	update.bind("@status", static_cast<unsigned>(BundleStatus::Retired));
+	update.bind("@replaced_by", static_cast<long long>(replacedById));
+	update.bind("@id", static_cast<long long>(bundle.Id));
+	const bool ret = (update.exec() == 1);
+	if (ret)
+	{
+		FilePath(bundle.FilePath).DeleteFile();
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(BundleCompacted(bundle.SiaPath, bundle.LiveBytes, bundle.Size)));
+	}
+
+	return ret;
+}
+
+// Retired bundles whose members are safely on Sia in their new bundle
+bool CUploadBundler::GetRetiredBundle(const unsigned& uploadCompleteStatus, BundleData& bundle)
+{
+	SQLite::Statement query(_database, QUERY_RETIRED_BUNDLE);
+	query.bind("@status", static_cast<unsigned>(BundleStatus::Retired));
+	query.bind("@upload_status", uploadCompleteStatus);
+	return ReadBundle(query, bundle);
+}
+
+// Forgets a retired bundle once it's been removed from Sia
+bool CUploadBundler::DeleteBundle(const BundleData& bundle)
+{
+	SQLite::Statement del(_database, DELETE_BUNDLE);
+	del.bind("@id", static_cast<long long>(bundle.Id));
+	return (del.exec() == 1);
+}
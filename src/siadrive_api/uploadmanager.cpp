@@ -1,29 +1,63 @@
 #include <SQLiteCpp/Exception.h>
+#include <SQLiteCpp/Transaction.h>
 #include <uploadmanager.h>
 #include <siaapi.h>
 #include <eventsystem.h>
 #include <siadriveconfig.h>
 #include <filepath.h>
+#include <unordered_set>
 
 using namespace Sia::Api;
 
 #define TABLE_CREATE L"create table if not exists %s (%s);"
 #define UPLOAD_TABLE L"upload_table"
-#define UPLOAD_TABLE_COLUMNS L"id integer primary key autoincrement, sia_path text unique not null, file_path text unique not null, status integer not null"
+#define UPLOAD_TABLE_COLUMNS L"id integer primary key autoincrement, sia_path text unique not null, file_path text unique not null, status integer not null, file_size integer not null default 0, priority integer not null default 0, modified_time integer not null default 0, content_hash text"
+#define PRIORITY_TABLE L"upload_priority_table"
+#define PRIORITY_TABLE_COLUMNS L"folder text primary key not null, priority integer not null"
 #define QUERY_STATUS "select * from upload_table where sia_path=@sia_path order by id desc limit 1;"
 #define QUERY_UPLOADS_BY_STATUS "select * from upload_table where status=@status order by id desc limit 1;"
-#define QUERY_UPLOAD_COUNT_BY_STATUS "select count(id) from upload_table where status=@status;"
+// Packed files aren't uploaded on their own - they follow their bundle's upload instead
+#define QUERY_UNPACKED_UPLOADS_BY_STATUS "select * from upload_table u where u.status=@status and not exists (select 1 from bundle_member_table m where m.sia_path=u.sia_path);"
+// Files small enough to be packed are left for PackSmallFiles() - bundles themselves are always uploaded
+#define QUERY_NEXT_UPLOADS_OLDEST "select * from upload_table where status=@status and (file_size=0 or file_size>=@small_file_size or sia_path like '.siadrive/%') order by id asc limit @limit;"
+#define QUERY_NEXT_UPLOADS_SMALLEST "select * from upload_table where status=@status and (file_size=0 or file_size>=@small_file_size or sia_path like '.siadrive/%') order by file_size asc, id asc limit @limit;"
+#define QUERY_NEXT_UPLOADS_PRIORITY "select * from upload_table where status=@status and (file_size=0 or file_size>=@small_file_size or sia_path like '.siadrive/%') order by priority desc, id asc limit @limit;"
+#define QUERY_FOLDER_PRIORITY "select priority from upload_priority_table where folder='' or substr(@sia_path, 1, length(folder) + 1)=folder || '/' order by length(folder) desc limit 1;"
+#define QUERY_SMALL_UPLOADS_BY_STATUS "select * from upload_table where status=@status and file_size>0 and file_size<@file_size and sia_path not like '.siadrive/%' order by id asc limit 1000;"
+#define QUERY_UPLOAD_COUNT_BY_STATUS "select count(id), ifnull(sum(file_size), 0) from upload_table where status=@status;"
 #define QUERY_UPLOADS_BY_SIA_PATH "select * from upload_table where sia_path=@sia_path order by id desc limit 1;"
 #define QUERY_UPLOADS_BY_SIA_PATH_AND_STATUS "select * from upload_table where sia_path=@sia_path and status=@status order by id desc limit 1;"
 #define UPDATE_STATUS "update upload_table set status=@status where sia_path=@sia_path;"
-#define INSERT_UPLOAD "insert into upload_table (sia_path, status, file_path) values (@sia_path, @status, @file_path);"
+#define UPDATE_QUEUED_FILE_SIZE "update upload_table set file_size=@file_size where sia_path=@sia_path and status=@status;"
+#define COMPLETE_PACKED_UPLOADS "update upload_table set status=@complete_status where status=@uploading_status and sia_path in (select m.sia_path from bundle_member_table m join bundle_table b on b.id=m.bundle_id join upload_table u on u.sia_path=b.sia_path where u.status=@complete_status);"
+#define REOPEN_PACKED_UPLOADS "update upload_table set status=@uploading_status where status=@complete_status and sia_path in (select m.sia_path from bundle_member_table m join bundle_table b on b.id=m.bundle_id left join upload_table u on u.sia_path=b.sia_path and u.status=@complete_status where u.id is null);"
+#define INSERT_UPLOAD "insert into upload_table (sia_path, status, file_path, file_size, priority, modified_time, content_hash) values (@sia_path, @status, @file_path, @file_size, @priority, @modified_time, @content_hash);"
+#define UPDATE_PENDING_UPLOAD "update upload_table set status=@status, file_path=@file_path, file_size=@file_size, modified_time=@modified_time, content_hash=@content_hash where sia_path=@sia_path;"
+#define QUERY_UNHASHED_DUE_UPLOADS "select sia_path, file_path, modified_time from upload_table where status=@status and modified_time<=@modified_time and ifnull(content_hash, '')='';"
+#define UPDATE_PENDING_HASH "update upload_table set content_hash=@content_hash where sia_path=@sia_path and status=@status and modified_time=@modified_time;"
+#define PROMOTE_PENDING_UPLOADS "update upload_table set status=@queued_status where status=@pending_status and modified_time<=@modified_time;"
+#define UPSERT_FOLDER_PRIORITY "insert or replace into upload_priority_table (folder, priority) values (@folder, @priority);"
+#define DELETE_FOLDER_PRIORITY "delete from upload_priority_table where folder=@folder;"
+#define UPDATE_PRIORITY_FOR_FOLDER "update upload_table set priority=coalesce((select priority from upload_priority_table where folder='' or substr(upload_table.sia_path, 1, length(folder) + 1)=folder || '/' order by length(folder) desc limit 1), 0) where @folder='' or substr(sia_path, 1, length(@folder) + 1)=@folder || '/';"
 #define DELETE_UPLOAD "delete from upload_table where sia_path=@sia_path;"
+#define QUERY_RECONCILE_UPLOADS "select u.sia_path, u.file_path, u.status from upload_table u where u.status in (@uploading_status, @complete_status) and not exists (select 1 from bundle_member_table m where m.sia_path=u.sia_path);"
+#define CREATE_STATUS_INDEX "create index if not exists upload_table_status_idx on upload_table (status, id);"
+#define CREATE_SIZE_INDEX "create index if not exists upload_table_size_idx on upload_table (status, file_size, id);"
+#define CREATE_PRIORITY_INDEX "create index if not exists upload_table_priority_idx on upload_table (status, priority desc, id);"
+#define ENABLE_WAL "pragma journal_mode=WAL;"
+#define SYNCHRONOUS_NORMAL "pragma synchronous=NORMAL;"
+
+#define THROUGHPUT_WINDOW_SECS 60
+#define UPLOAD_PROGRESS_WINDOW_SECS 120
+#define BUNDLE_MAX_OPEN_SECS 60
+// Percent steps a slow upload is allowed to take before it's considered stalled
+#define UPLOAD_STALL_PERCENT_STEPS 3
 
 #define SET_STATUS(status, success_event, fail_event)\
 bool statusUpdated = false;\
 try\
 {\
-	SQLite::Statement update(_uploadDatabase, UPDATE_STATUS);\
+	SQLite::Statement& update = GetStatement(UPDATE_STATUS);\
 	update.bind("@sia_path", SString::ToUtf8(siaPath).c_str());\
 	update.bind("@status", static_cast<unsigned>(status));\
 	if (update.exec() != 1)\
@@ -59,6 +93,89 @@ static void CreateTableIfNotFound(SQLite::Database* database, const SString& tab
 	database->exec(SString::ToUtf8(sqlCreate).c_str());
 }
 
+// Databases created before a column was added are migrated in place
+static void AddColumnIfNotFound(SQLite::Database* database, const SString& tableName, const SString& columnName, const SString& definition)
+{
+	bool found = false;
+	{
+		SQLite::Statement query(*database, "pragma table_info(" + SString::ToUtf8(tableName) + ");");
+		while (!found && query.executeStep())
+		{
+			found = (SString::ToUtf8(columnName) == static_cast<const char*>(query.getColumn(1)));
+		}
+	}
+
+	if (!found)
+	{
+		database->exec("alter table " + SString::ToUtf8(tableName) + " add column " + SString::ToUtf8(columnName) + " " + SString::ToUtf8(definition) + ";");
+	}
+}
+
+// Seconds since epoch - pending uploads outlive restarts
+static std::int64_t GetModifiedTime()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// siad only reports whole percents, so a slow upload can go a long time without visible progress. The configured
+//	timeout is stretched to cover a few percent of the file at 'bytesPerSecond' (0 if unknown).
+static std::chrono::seconds GetUploadStallTimeout(const std::chrono::seconds& configuredTimeout, const std::uint64_t& fileSize, const std::uint64_t& bytesPerSecond)
+{
+	const std::chrono::seconds percentTimeout(bytesPerSecond ? (UPLOAD_STALL_PERCENT_STEPS * (fileSize / 100)) / bytesPerSecond : 0);
+	return (percentTimeout > configuredTimeout) ? percentTimeout : configuredTimeout;
+}
+
+static std::uint64_t GetSourceFileSize(const SString& filePath)
+{
+	std::uint64_t ret = 0;
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA fad = { 0 };
+	if (::GetFileAttributesEx(&filePath[0], GetFileExInfoStandard, &fad))
+	{
+		ret = (static_cast<std::uint64_t>(fad.nFileSizeHigh) << 32) | fad.nFileSizeLow;
+	}
+#else
+	a
+#endif
+
+	return ret;
+}
+
+SString CUploadManager::UploadOrderPolicyToString(const UploadOrderPolicy& uploadOrderPolicy)
+{
+	switch (uploadOrderPolicy)
+	{
+	case UploadOrderPolicy::OldestFirst:
+		return L"oldest_first";
+
+	case UploadOrderPolicy::SmallestFirst:
+		return L"smallest_first";
+
+	case UploadOrderPolicy::Priority:
+		return L"priority";
+
+	case UploadOrderPolicy::FairShare:
+		return L"fair_share";
+
+	default:
+		return L"!!Not Defined!!";
+	}
+}
+
+// Unrecognized policies fall back to fair share
+UploadOrderPolicy CUploadManager::UploadOrderPolicyFromString(const SString& uploadOrderPolicy)
+{
+	for (const auto& policy : { UploadOrderPolicy::OldestFirst, UploadOrderPolicy::SmallestFirst, UploadOrderPolicy::Priority })
+	{
+		if (UploadOrderPolicyToString(policy) == uploadOrderPolicy)
+		{
+			return policy;
+		}
+	}
+
+	return UploadOrderPolicy::FairShare;
+}
+
 SString CUploadManager::UploadStatusToString(const UploadStatus& uploadStatus)
 {
 	switch (uploadStatus)
@@ -78,6 +195,9 @@ SString CUploadManager::UploadStatusToString(const UploadStatus& uploadStatus)
 	case UploadStatus::Uploading:
 		return L"Uploading";
 
+	case UploadStatus::Pending:
+		return L"Pending";
+
 	default:
 		return L"!!Not Defined!!";
 	}
@@ -86,14 +206,38 @@ SString CUploadManager::UploadStatusToString(const UploadStatus& uploadStatus)
 CUploadManager::CUploadManager(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig) :
 	CAutoThread(siaCurl, siaDriveConfig),
   _siaDriveConfig(siaDriveConfig),
-	_uploadDatabase(siaDriveConfig->GetRenter_UploadDbFilePath(), SQLite::OPEN_CREATE | SQLite::OPEN_READWRITE)
+	_uploadDatabase(siaDriveConfig->GetRenter_UploadDbFilePath(), SQLite::OPEN_CREATE | SQLite::OPEN_READWRITE),
+	_totalUploadProgress({ SString(), 0, 0, 0, -1 }),
+	_reconciled(false),
+	_queueDepth(0),
+	_inFlightCount(0),
+	_bytesPerSecond(0),
+	_pendingCount(0),
+	_avoidedUploadCount(0),
+	_dedupBytesSaved(0),
+	_pendingRemovals(new PendingRemovalData())
 {
+	// WAL lets status queries run alongside writes, and NORMAL sync only flushes at checkpoints
+	_uploadDatabase.exec(ENABLE_WAL);
+	_uploadDatabase.exec(SYNCHRONOUS_NORMAL);
 	CreateTableIfNotFound(&_uploadDatabase, UPLOAD_TABLE, UPLOAD_TABLE_COLUMNS);
+	CreateTableIfNotFound(&_uploadDatabase, PRIORITY_TABLE, PRIORITY_TABLE_COLUMNS);
+	AddColumnIfNotFound(&_uploadDatabase, UPLOAD_TABLE, L"file_size", L"integer not null default 0");
+	AddColumnIfNotFound(&_uploadDatabase, UPLOAD_TABLE, L"priority", L"integer not null default 0");
+	AddColumnIfNotFound(&_uploadDatabase, UPLOAD_TABLE, L"modified_time", L"integer not null default 0");
+	AddColumnIfNotFound(&_uploadDatabase, UPLOAD_TABLE, L"content_hash", L"text");
+	_uploadDatabase.exec(CREATE_STATUS_INDEX);
+	_uploadDatabase.exec(CREATE_SIZE_INDEX);
+	_uploadDatabase.exec(CREATE_PRIORITY_INDEX);
+
+	// Bundles live next to the upload database - packed files are read back from them
+	FilePath bundleFolder(siaDriveConfig->GetRenter_UploadDbFilePath());
+	bundleFolder.RemoveFileName().Append(L"bundles");
+	_uploadBundler.reset(new CUploadBundler(_uploadDatabase, bundleFolder));
 
-	// Detect files that have been removed since last startup
-	DeleteFilesRemovedFromSia(siaCurl, siaDriveConfig, true);
+	_bandwidthPolicy.Update(siaDriveConfig);
 
-	// Begin normal processing
+	// Begin normal processing - the first pass reconciles with Sia so mounting isn't held up by the renter listing
 	StartAutoThread();
 }
 
@@ -103,24 +247,128 @@ CUploadManager::~CUploadManager()
 	StopAutoThread();
 }
 
-void CUploadManager::DeleteFilesRemovedFromSia(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig, const bool& isStartup)
+// Statements are prepared once and reset on each use - callers must hold _uploadMutex
+SQLite::Statement& CUploadManager::GetStatement(const std::string& sql)
 {
-	CSiaFileTreePtr fileTree(new CSiaFileTree(siaCurl, siaDriveConfig));
-	json result;
-	SiaCurlError cerror = siaCurl.Get(L"/renter/files", result);
-	if (ApiSuccess(cerror))
+	auto& statement = _statementCache[sql];
+	if (statement)
 	{
-		fileTree->BuildTree(result);
-		auto fileList = fileTree->GetFileList();
-    // TODO Implement this
+		statement->reset();
+		statement->clearBindings();
 	}
 	else
 	{
-		if (isStartup)
+		statement.reset(new SQLite::Statement(_uploadDatabase, sql));
+	}
+
+	return *statement;
+}
+
+// Callers must hold _uploadMutex. Brings the upload table in line with the renter listing in one pass so rows left
+//	behind by a crash or by other clients aren't discovered one at a time:
+//	- Uploading rows that finished while we weren't watching are completed
+//	- Uploading rows siad no longer knows about are queued again, or dropped if the source file is gone
+//	- Complete rows no longer on Sia were removed elsewhere and are dropped
+//	Packed files are never listed by siad and are left to the bundle index. A listing can come back empty or
+//	short (i.e. siad just restarted), so rows are only treated as missing once they're absent from two listings -
+//	the second fetched after 'freshnessMs' so it isn't the same shared result. Returns true once complete.
+bool CUploadManager::DeleteFilesRemovedFromSia(const CSiaFileStore& fileStore, const std::uint32_t& freshnessMs)
+{
+	const auto started = std::chrono::steady_clock::now();
+	const bool confirming = !_missingFromSia.empty();
+	if (confirming && (started - _missingCheckedAt <= std::chrono::milliseconds(freshnessMs)))
+	{
+		return false;
+	}
+
+	std::unordered_map<std::string, bool> siaFiles;
+	siaFiles.reserve(fileStore.GetCount());
+	for (std::uint32_t i = 0; i < fileStore.GetCount(); i++)
+	{
+		siaFiles.insert({ fileStore.GetSiaPathUtf8(i), fileStore.GetAvailable(i) });
+	}
+
+	std::uint64_t rowCount = 0;
+	std::unordered_set<std::string> missing;
+	std::vector<std::string> completed;
+	std::vector<std::string> requeued;
+	std::vector<std::string> removed;
+	{
+		SQLite::Statement query(_uploadDatabase, QUERY_RECONCILE_UPLOADS);
+		query.bind("@uploading_status", static_cast<unsigned>(UploadStatus::Uploading));
+		query.bind("@complete_status", static_cast<unsigned>(UploadStatus::Complete));
+		while (query.executeStep())
+		{
+			rowCount++;
+			const std::string siaPath = static_cast<const char*>(query.getColumn(0));
+			const UploadStatus status = static_cast<UploadStatus>(query.getColumn(2).getInt());
+			auto it = siaFiles.find(siaPath);
+			if ((it == siaFiles.end()) && (!confirming || (_missingFromSia.find(siaPath) == _missingFromSia.end())))
+			{
+				missing.insert(siaPath);
+			}
+			else if (status == UploadStatus::Uploading)
+			{
+				if (it == siaFiles.end())
+				{
+					if (FilePath(SString(static_cast<const char*>(query.getColumn(1)))).IsFile())
+					{
+						requeued.push_back(siaPath);
+					}
+					else
+					{
+						removed.push_back(siaPath);
+					}
+				}
+				else if (it->second)
+				{
+					completed.push_back(siaPath);
+				}
+			}
+			else if (it == siaFiles.end())
+			{
+				removed.push_back(siaPath);
+			}
+		}
+	}
+
+	if (!completed.empty() || !requeued.empty() || !removed.empty())
+	{
+		SQLite::Transaction transaction(_uploadDatabase);
+		SQLite::Statement& update = GetStatement(UPDATE_STATUS);
+		for (const auto& siaPath : completed)
+		{
+			update.bind("@sia_path", siaPath.c_str());
+			update.bind("@status", static_cast<unsigned>(UploadStatus::Complete));
+			update.exec();
+			update.reset();
+		}
+
+		for (const auto& siaPath : requeued)
+		{
+			update.bind("@sia_path", siaPath.c_str());
+			update.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+			update.exec();
+			update.reset();
+		}
+
+		SQLite::Statement& del = GetStatement(DELETE_UPLOAD);
+		for (const auto& siaPath : removed)
 		{
-			throw StartupException(L"Failed to get Sia files");
+			del.bind("@sia_path", siaPath.c_str());
+			del.exec();
+			del.reset();
 		}
+		transaction.commit();
 	}
+
+	const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+	CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(UploadTableReconciled(rowCount, siaFiles.size(), completed.size(), requeued.size(), removed.size(), elapsedMs)));
+
+	// Rows missing for the first time are checked again against the next listing
+	_missingFromSia = confirming ? std::unordered_set<std::string>() : std::move(missing);
+	_missingCheckedAt = started;
+	return _missingFromSia.empty();
 }
 
 bool CUploadManager::HandleFileRemove(const CSiaCurl& siaCurl, const SString& siaPath)
@@ -128,11 +376,17 @@ bool CUploadManager::HandleFileRemove(const CSiaCurl& siaCurl, const SString& si
   bool ret = false;
   FilePath removeFilePath(GetSiaDriveConfig()->GetCacheFolder(), siaPath);
 	
+  // Packed files only exist inside their bundle - dropping the index entry is enough
   json response;
-  SiaCurlError cerror = siaCurl.Post(SString(L"/renter/delete/") + siaPath, {}, response);
+  SiaCurlError cerror;
+  if (!_uploadBundler->RemoveMember(siaPath))
+  {
+    cerror = siaCurl.Post(SString(L"/renter/delete/") + siaPath, {}, response);
+  }
+
   if (ApiSuccess(cerror))
   {
-    SQLite::Statement del(_uploadDatabase, DELETE_UPLOAD);
+    SQLite::Statement& del = GetStatement(DELETE_UPLOAD);
     del.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
     if (del.exec() >= 0)
     {
@@ -152,142 +406,663 @@ bool CUploadManager::HandleFileRemove(const CSiaCurl& siaCurl, const SString& si
   return ret;
 }
 
-void CUploadManager::AutoThreadCallback(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig)
+// 'downloadedBytes' receives the bundle size if this call fetched it from Sia, 0 if it was already local
+//	or fetched by a concurrent caller
+bool CUploadManager::DownloadBundle(const CSiaCurl& siaCurl, const CUploadBundler::BundleData& bundle, std::uint64_t& downloadedBytes)
 {
-	bool processNext = true;
-
-	try
+	downloadedBytes = 0;
+	// Concurrent reads of members from the same bundle share one download instead of racing on the temp file
+	return _bundleDownloads.Do(bundle.SiaPath, 0, [&](bool& shareable) -> bool
 	{
-		CSiaFileTreePtr fileTree(new CSiaFileTree(siaCurl, siaDriveConfig));
-		json result;
-		if (ApiSuccess(siaCurl.Get(L"/renter/files", result)))
+		shareable = false;
+		bool ret = FilePath(bundle.FilePath).IsFile();
+		if (!ret)
 		{
-			fileTree->BuildTree(result);
+			FilePath tempFilePath(bundle.FilePath + L".siatmp");
+			json response;
+			ret = ApiSuccess(siaCurl.Get(L"/renter/download/" + bundle.SiaPath, { { L"destination", tempFilePath } }, response)) && tempFilePath.MoveFile(bundle.FilePath);
+			if (ret)
+			{
+				downloadedBytes = bundle.Size;
+			}
+			else
+			{
+				tempFilePath.DeleteFile();
+			}
+		}
 
-			// Lock here - if file is modified again before previously queued upload is complete, delete it and 
-			//	start again later
-			std::lock_guard<std::mutex> l(_uploadMutex);
-			SQLite::Statement query(_uploadDatabase, QUERY_UPLOADS_BY_STATUS);
-			query.bind("@status", static_cast<unsigned>(UploadStatus::Uploading));
-			if (query.executeStep())
+		return ret;
+	});
+}
+
+// Callers must hold _uploadMutex. Packed files are only on Sia once their bundle is, so their rows stay
+//	Uploading until the bundle's upload completes - and go back to Uploading when moved to a new bundle.
+void CUploadManager::SyncPackedUploads()
+{
+	SQLite::Statement& complete = GetStatement(COMPLETE_PACKED_UPLOADS);
+	complete.bind("@complete_status", static_cast<unsigned>(UploadStatus::Complete));
+	complete.bind("@uploading_status", static_cast<unsigned>(UploadStatus::Uploading));
+	complete.exec();
+
+	SQLite::Statement& reopen = GetStatement(REOPEN_PACKED_UPLOADS);
+	reopen.bind("@complete_status", static_cast<unsigned>(UploadStatus::Complete));
+	reopen.bind("@uploading_status", static_cast<unsigned>(UploadStatus::Uploading));
+	reopen.exec();
+}
+
+// Queued small files are appended to the open bundle instead of being uploaded on their own. At most one
+//	bundle's worth is packed per pass, so a bundle is sealed and queued as soon as it reaches its target. Files
+//	are copied without holding _uploadMutex and only recorded if their row is still queued afterwards.
+void CUploadManager::PackSmallFiles(CSiaDriveConfig* siaDriveConfig)
+{
+	std::vector<std::pair<std::pair<SString, SString>, std::uint64_t>> uploads;
+	CUploadBundler::BundleData bundle;
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		if (siaDriveConfig->GetEnableSmallFilePacking())
+		{
+			SQLite::Statement& query = GetStatement(QUERY_SMALL_UPLOADS_BY_STATUS);
+			query.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+			query.bind("@file_size", static_cast<long long>(siaDriveConfig->GetSmallFileThresholdBytes()));
+			while (query.executeStep())
 			{
-				SString siaPath = static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path")));
-				SString filePath = static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path")));
-				UploadStatus uploadStatus = static_cast<UploadStatus>(query.getColumn(query.getColumnIndex("status")).getUInt());
+				uploads.push_back({ { static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path"))), static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path"))) }, query.getColumn(query.getColumnIndex("file_size")).getInt64() });
+			}
+			query.reset();
+		}
 
-				auto fileList = fileTree->GetFileList();
-				auto it = std::find_if(fileList->begin(), fileList->end(), [&](const CSiaFilePtr& ptr)
-				{
-					return ptr->GetSiaPath() == siaPath;
-				});
-				
-				// Removed by another client
-        if (it == fileList->end())
-        {
-          HandleFileRemove(siaCurl, siaPath);
-        }
-				// Upload is complete
-				else if ((*it)->GetAvailable())
-				{
-					SET_STATUS(UploadStatus::Complete, UploadToSiaComplete, ModifyUploadStatusFailed)
-				}
-				// Upload still active, don't process another file
-				else
-				{
-          SQLite::Statement count(_uploadDatabase, QUERY_UPLOAD_COUNT_BY_STATUS);
-          count.bind("@status", static_cast<unsigned>(UploadStatus::Uploading));
-          processNext = (count.executeStep() && (count.getColumn(0).getInt64() < _siaDriveConfig->GetMaxUploadCount()));
-				}
+		// The first file is always taken so a bundle over its target is still sealed below
+		if (!uploads.empty() && _uploadBundler->GetOpenBundle(bundle))
+		{
+			const std::uint64_t targetBytes = siaDriveConfig->GetBundleTargetBytes();
+			std::uint64_t packBytes = bundle.Size;
+			std::size_t count = 0;
+			while ((count < uploads.size()) && (!count || (packBytes + uploads[count].second <= targetBytes)))
+			{
+				packBytes += uploads[count++].second;
 			}
+			uploads.resize(count);
 		}
 		else
 		{
-			// error condition - host down?
-			processNext = false;
+			uploads.clear();
 		}
 	}
-	catch (const SQLite::Exception& e)
+
+	// Files that fail to copy (i.e. changed size since queued) are measured again - those no longer small
+	//	are left for a normal upload
+	std::vector<std::pair<std::pair<SString, SString>, std::pair<std::uint64_t, std::uint64_t>>> packed;
+	std::vector<std::pair<SString, std::uint64_t>> resized;
+	for (const auto& upload : uploads)
 	{
-		// error condition - database not initialized (i.e. no table)?
-		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("AutoThreadCallback(/renter/files)", e)));
-		processNext = false;
+		std::uint64_t offset;
+		if (CUploadBundler::CopyFileRange(upload.first.second, 0, upload.second, bundle.FilePath, offset))
+		{
+			packed.push_back({ upload.first, { offset, upload.second } });
+		}
+		else
+		{
+			resized.push_back({ upload.first.first, GetSourceFileSize(upload.first.second) });
+		}
 	}
 
-	if (processNext)
+	std::lock_guard<std::mutex> l(_uploadMutex);
+	SQLite::Transaction transaction(_uploadDatabase);
+	for (std::size_t i = 0; i < packed.size(); i++)
 	{
-		try
+		const SString& siaPath = packed[i].first.first;
+		const SString& filePath = packed[i].first.second;
+		const std::uint64_t fileSize = packed[i].second.second;
+		bool unchanged = false;
 		{
-			std::lock_guard<std::mutex> l(_uploadMutex);
-			SQLite::Statement query(_uploadDatabase, QUERY_UPLOADS_BY_STATUS);
+			SQLite::Statement& query = GetStatement(QUERY_UPLOADS_BY_SIA_PATH_AND_STATUS);
+			query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
 			query.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
-			if (query.executeStep())
+			unchanged = query.executeStep() && (static_cast<std::uint64_t>(query.getColumn(query.getColumnIndex("file_size")).getInt64()) == fileSize);
+			query.reset();
+		}
+
+		// Rows modified or removed while copying leave their copy behind as stale data
+		if (unchanged && _uploadBundler->Pack(siaPath, packed[i].second.first, fileSize, bundle))
+		{
+			SQLite::Statement& update = GetStatement(UPDATE_STATUS);
+			update.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+			update.bind("@status", static_cast<unsigned>(UploadStatus::Uploading));
+			if (update.exec() == 1)
+			{
+				CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(FilePackedIntoBundle(siaPath, bundle.SiaPath)));
+			}
+			else
+			{
+				CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(ModifyUploadStatusFailed(siaPath, filePath, UploadStatus::Uploading, update.getErrorMsg())));
+			}
+		}
+	}
+
+	for (const auto& upload : resized)
+	{
+		SQLite::Statement& update = GetStatement(UPDATE_QUEUED_FILE_SIZE);
+		update.bind("@sia_path", SString::ToUtf8(upload.first).c_str());
+		update.bind("@file_size", static_cast<long long>(upload.second));
+		update.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+		update.exec();
+	}
+
+	// Bundles left open by an earlier pass are still sealed once they've waited long enough
+	if (_uploadBundler->SealIfReady(siaDriveConfig->GetBundleTargetBytes(), BUNDLE_MAX_OPEN_SECS, bundle))
+	{
+		SQLite::Statement& insert = GetStatement(INSERT_UPLOAD);
+		insert.bind("@sia_path", SString::ToUtf8(bundle.SiaPath).c_str());
+		insert.bind("@file_path", SString::ToUtf8(bundle.FilePath).c_str());
+		insert.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+		insert.bind("@file_size", static_cast<long long>(bundle.Size));
+		insert.bind("@priority", 0);
+		insert.bind("@modified_time", static_cast<long long>(GetModifiedTime()));
+		insert.bind("@content_hash", "");
+		insert.exec();
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(BundleSealed(bundle.SiaPath, bundle.Size)));
+	}
+	transaction.commit();
+}
+
+// Callers must hold _uploadMutex. A compacted bundle is only deleted from Sia once the bundle its members
+//	moved to has finished uploading - one per pass.
+void CUploadManager::RemoveRetiredBundles(const CSiaCurl& siaCurl)
+{
+	CUploadBundler::BundleData bundle;
+	if (_uploadBundler->GetRetiredBundle(static_cast<unsigned>(UploadStatus::Complete), bundle) && HandleFileRemove(siaCurl, bundle.SiaPath))
+	{
+		_uploadBundler->DeleteBundle(bundle);
+	}
+}
+
+// One bundle per pass - its live members are copied to the open bundle and the old one is retired. The bundle
+//	is downloaded and copied without holding _uploadMutex so opening files on the drive isn't blocked meanwhile.
+void CUploadManager::CompactBundles(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig)
+{
+	CUploadBundler::BundleData bundle;
+	bool found;
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		RemoveRetiredBundles(siaCurl);
+		found = siaDriveConfig->GetEnableSmallFilePacking() &&
+			_uploadBundler->GetCompactionCandidate(siaDriveConfig->GetBundleCompactionPercent(), static_cast<unsigned>(UploadStatus::Complete), bundle);
+	}
+
+	std::uint64_t downloadedBytes = 0;
+	found = found && DownloadBundle(siaCurl, bundle, downloadedBytes);
+	_bandwidthPolicy.Consume(BandwidthDirection::Download, downloadedBytes);
+
+	std::vector<std::pair<SString, CUploadBundler::MemberData>> members;
+	CUploadBundler::BundleData target = { 0 };
+	if (found)
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		members = _uploadBundler->GetMembers(bundle);
+		found = members.empty() || _uploadBundler->GetOpenBundle(target);
+	}
+
+	std::vector<std::uint64_t> offsets;
+	for (std::size_t i = 0; found && (i < members.size()); i++)
+	{
+		std::uint64_t offset;
+		found = CUploadBundler::CopyFileRange(bundle.FilePath, members[i].second.Offset, members[i].second.Length, target.FilePath, offset);
+		offsets.push_back(offset);
+	}
+
+	if (found)
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		SQLite::Transaction compaction(_uploadDatabase);
+
+		// Members removed or replaced while copying are no longer in the bundle and aren't moved
+		for (std::size_t i = 0; i < members.size(); i++)
+		{
+			CUploadBundler::MemberData member;
+			if (_uploadBundler->GetMember(members[i].first, member) && (member.Bundle.Id == bundle.Id) && (member.Offset == members[i].second.Offset))
 			{
-				SString siaPath = static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path")));
-        SString filePath = static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path")));
-        
-        json response;
-        SiaCurlError cerror = siaCurl.Post(SString(L"/renter/upload/") + siaPath, { {L"source", filePath} }, response);
-        if (ApiSuccess(cerror))
-        {
-          SET_STATUS(UploadStatus::Uploading, UploadToSiaStarted, ModifyUploadStatusFailed)
-        }
+				_uploadBundler->Pack(members[i].first, offsets[i], member.Length, target);
 			}
 		}
-		catch (const SQLite::Exception& e)
+
+		if (_uploadBundler->Retire(bundle, target.Id))
 		{
-			// error condition
-			CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("AutoThreadCallback(processNext)", e)));
+			SyncPackedUploads();
+			compaction.commit();
 		}
 	}
 }
 
+// Callers must hold _uploadMutex. Records the latest estimate for an active upload in 'tracking', carrying over
+//	its history from the previous pass, and returns the bytes sent since then.
+std::uint64_t CUploadManager::TrackUploadProgress(const SString& siaPath, const std::uint64_t& fileSize, const std::uint64_t& uploadedBytes, std::unordered_map<SString, UploadTrackingData>& tracking)
+{
+	const auto now = std::chrono::steady_clock::now();
+	auto it = _uploadTracking.find(siaPath);
+	UploadTrackingData& upload = tracking[siaPath];
+	// Progress made before an upload was first seen (i.e. prior to a restart) isn't attributed to this pass
+	if (it == _uploadTracking.end())
+	{
+		upload.FileSize = fileSize;
+		upload.UploadedBytes = uploadedBytes;
+		upload.LastProgress = now;
+	}
+	else
+	{
+		upload = std::move(it->second);
+	}
+
+	const std::uint64_t ret = (uploadedBytes > upload.UploadedBytes) ? uploadedBytes - upload.UploadedBytes : 0;
+	if (ret || (fileSize != upload.FileSize))
+	{
+		upload.LastProgress = now;
+	}
+	upload.FileSize = fileSize;
+	upload.UploadedBytes = uploadedBytes;
+
+	upload.Samples.push_back({ now, uploadedBytes });
+	while (now - upload.Samples.front().first > std::chrono::seconds(UPLOAD_PROGRESS_WINDOW_SECS))
+	{
+		upload.Samples.pop_front();
+	}
+
+	return ret;
+}
+
+// Callers must hold _uploadMutex. Rates are taken over each upload's sample window; the total ETA also covers
+//	bytes still waiting in the queue.
+void CUploadManager::UpdateUploadProgress(const std::uint64_t& queuedBytes)
+{
+	std::vector<UploadProgressData> uploadProgress;
+	UploadProgressData totalUploadProgress = { SString(), queuedBytes, 0, 0, -1 };
+	for (const auto& kv : _uploadTracking)
+	{
+		const UploadTrackingData& upload = kv.second;
+		const double elapsed = std::chrono::duration<double>(upload.Samples.back().first - upload.Samples.front().first).count();
+		const std::uint64_t bytesPerSecond = (elapsed > 0) ? static_cast<std::uint64_t>((upload.Samples.back().second - upload.Samples.front().second) / elapsed) : 0;
+		const std::uint64_t remainingBytes = (upload.FileSize > upload.UploadedBytes) ? upload.FileSize - upload.UploadedBytes : 0;
+		uploadProgress.push_back({ kv.first, upload.FileSize, upload.UploadedBytes, bytesPerSecond, bytesPerSecond ? static_cast<std::int64_t>(remainingBytes / bytesPerSecond) : -1 });
+
+		totalUploadProgress.FileSize += upload.FileSize;
+		totalUploadProgress.UploadedBytes += upload.UploadedBytes;
+		totalUploadProgress.BytesPerSecond += bytesPerSecond;
+	}
+
+	if (totalUploadProgress.BytesPerSecond)
+	{
+		totalUploadProgress.EtaSeconds = static_cast<std::int64_t>((totalUploadProgress.FileSize - totalUploadProgress.UploadedBytes) / totalUploadProgress.BytesPerSecond);
+	}
+	else if (totalUploadProgress.FileSize == totalUploadProgress.UploadedBytes)
+	{
+		totalUploadProgress.EtaSeconds = 0;
+	}
+
+	std::lock_guard<std::mutex> l(_progressMutex);
+	_uploadProgress = std::move(uploadProgress);
+	_totalUploadProgress = totalUploadProgress;
+}
+
+// Throughput is averaged over completions in the last THROUGHPUT_WINDOW_SECS
+void CUploadManager::UpdateMetrics(const std::uint64_t& queueDepth, const std::uint64_t& inFlightCount, const std::uint64_t& completedBytes)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (completedBytes)
+	{
+		_completedUploads.push_back({ now, completedBytes });
+	}
+
+	while (!_completedUploads.empty() && (now - _completedUploads.front().first > std::chrono::seconds(THROUGHPUT_WINDOW_SECS)))
+	{
+		_completedUploads.pop_front();
+	}
+
+	std::uint64_t windowBytes = 0;
+	for (const auto& completed : _completedUploads)
+	{
+		windowBytes += completed.second;
+	}
+	const std::uint64_t bytesPerSecond = windowBytes / THROUGHPUT_WINDOW_SECS;
+
+	if ((queueDepth != _queueDepth) || (inFlightCount != _inFlightCount) || (bytesPerSecond != _bytesPerSecond))
+	{
+		_queueDepth = queueDepth;
+		_inFlightCount = inFlightCount;
+		_bytesPerSecond = bytesPerSecond;
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(UploadQueueStatusChanged(queueDepth, inFlightCount, bytesPerSecond)));
+	}
+}
+
+// Callers must hold _uploadMutex
+std::vector<std::pair<SString, SString>> CUploadManager::QueryUploads(const std::string& sql, const std::uint64_t& count, const std::uint64_t& smallFileSize)
+{
+	std::vector<std::pair<SString, SString>> ret;
+	SQLite::Statement& query = GetStatement(sql);
+	query.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+	query.bind("@small_file_size", static_cast<long long>(smallFileSize));
+	query.bind("@limit", static_cast<unsigned>(count));
+	while (query.executeStep())
+	{
+		ret.push_back({ static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path"))), static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path"))) });
+	}
+
+	return ret;
+}
+
+// Each policy is served by its own index, so only 'count' rows are read per ordering. Fair share
+//	takes turns between priority, smallest and oldest so no one kind of upload starves the others.
+std::vector<std::pair<SString, SString>> CUploadManager::GetNextUploads(const UploadOrderPolicy& uploadOrderPolicy, const std::uint64_t& count, const std::uint64_t& smallFileSize)
+{
+	switch (uploadOrderPolicy)
+	{
+	case UploadOrderPolicy::OldestFirst:
+		return QueryUploads(QUERY_NEXT_UPLOADS_OLDEST, count, smallFileSize);
+
+	case UploadOrderPolicy::SmallestFirst:
+		return QueryUploads(QUERY_NEXT_UPLOADS_SMALLEST, count, smallFileSize);
+
+	case UploadOrderPolicy::Priority:
+		return QueryUploads(QUERY_NEXT_UPLOADS_PRIORITY, count, smallFileSize);
+
+	default:
+	{
+		const std::vector<std::pair<SString, SString>> candidates[] =
+		{
+			QueryUploads(QUERY_NEXT_UPLOADS_PRIORITY, count, smallFileSize),
+			QueryUploads(QUERY_NEXT_UPLOADS_SMALLEST, count, smallFileSize),
+			QueryUploads(QUERY_NEXT_UPLOADS_OLDEST, count, smallFileSize)
+		};
+
+		std::vector<std::pair<SString, SString>> ret;
+		std::unordered_set<std::wstring> selected;
+		for (std::size_t i = 0; (ret.size() < count) && (i < count); i++)
+		{
+			for (const auto& candidate : candidates)
+			{
+				if ((ret.size() < count) && (i < candidate.size()) && selected.insert(candidate[i].first.str()).second)
+				{
+					ret.push_back(candidate[i]);
+				}
+			}
+		}
+
+		return ret;
+	}
+	}
+}
+
+void CUploadManager::AutoThreadCallback(const CSiaCurl& siaCurl, CSiaDriveConfig* siaDriveConfig)
+{
+	try
+	{
+		CSiaFileTreePtr fileTree;
+		if (ApiSuccess(CSiaFileTree::FetchShared(siaCurl, siaDriveConfig, fileTree)))
+		{
+			HashDueUploads(siaDriveConfig);
+			// Existing bundles are looked after even if packing has since been disabled
+			CompactBundles(siaCurl, siaDriveConfig);
+			PackSmallFiles(siaDriveConfig);
+
+			// Lock here - if file is modified again before previously queued upload is complete, delete it and 
+			//	start again later
+			std::lock_guard<std::mutex> l(_uploadMutex);
+
+			// Detect files that have been removed since last startup
+			if (!_reconciled)
+			{
+				_reconciled = DeleteFilesRemovedFromSia(*fileTree->GetFileStore(), siaDriveConfig->GetFileTreeFreshnessMs());
+				SyncPackedUploads();
+			}
+
+			// Check every active upload against the file tree in one pass. Rows are read up front since
+			//	status changes write to the table being queried.
+			std::vector<std::pair<SString, SString>> uploads;
+			{
+				SQLite::Statement& query = GetStatement(QUERY_UNPACKED_UPLOADS_BY_STATUS);
+				query.bind("@status", static_cast<unsigned>(UploadStatus::Uploading));
+				while (query.executeStep())
+				{
+					uploads.push_back({ static_cast<const char*>(query.getColumn(query.getColumnIndex("sia_path"))), static_cast<const char*>(query.getColumn(query.getColumnIndex("file_path"))) });
+				}
+			}
+
+			std::uint64_t inFlightCount = 0;
+			std::uint64_t completedBytes = 0;
+			std::uint64_t uploadedBytes = 0;
+			std::vector<SString> removed;
+			std::vector<std::pair<SString, SString>> stalled;
+			std::unordered_map<SString, UploadTrackingData> tracking;
+			const std::chrono::seconds stallTimeout = std::chrono::minutes(siaDriveConfig->GetUploadStallTimeoutMins());
+			// Expected per-upload rate is the slower of the observed rate and the upload limit, each shared across
+			//	active uploads. Uploads held back by the bandwidth policy are never considered stalled.
+			const std::uint64_t observedRate = uploads.empty() ? 0 : _bandwidthPolicy.GetUsage(BandwidthDirection::Upload) / uploads.size();
+			const std::uint64_t limitedRate = uploads.empty() ? 0 : _bandwidthPolicy.GetLimit(BandwidthDirection::Upload) / uploads.size();
+			const std::uint64_t expectedRate = (observedRate && limitedRate) ? ((observedRate < limitedRate) ? observedRate : limitedRate) : (observedRate ? observedRate : limitedRate);
+			const bool uploadThrottled = !_bandwidthPolicy.TryAcquire(BandwidthDirection::Upload);
+			{
+				// Completions are committed together, along with the packed files of any bundle that completed
+				SQLite::Transaction transaction(_uploadDatabase);
+				bool bundleCompleted = false;
+				for (const auto& upload : uploads)
+				{
+					const SString& siaPath = upload.first;
+					const SString& filePath = upload.second;
+					auto siaFile = fileTree->GetFile(siaPath);
+
+					// Removed by another client
+					if (!siaFile)
+					{
+						removed.push_back(siaPath);
+					}
+					// Upload is complete
+					else if (siaFile->GetAvailable())
+					{
+						uploadedBytes += TrackUploadProgress(siaPath, siaFile->GetFileSize(), siaFile->GetFileSize(), tracking);
+						SET_STATUS(UploadStatus::Complete, UploadToSiaComplete, ModifyUploadStatusFailed)
+						if (statusUpdated)
+						{
+							completedBytes += siaFile->GetFileSize();
+							tracking.erase(siaPath);
+							bundleCompleted = bundleCompleted || CUploadBundler::IsBundlePath(siaPath);
+						}
+					}
+					// Upload still active
+					else
+					{
+						// siad only reports a percentage - estimate the bytes sent from it
+						const std::uint32_t progress = siaFile->GetUploadProgress();
+						uploadedBytes += TrackUploadProgress(siaPath, siaFile->GetFileSize(), (siaFile->GetFileSize() * ((progress > 100) ? 100 : progress)) / 100, tracking);
+						UploadTrackingData& trackedUpload = tracking[siaPath];
+						// Time spent throttled doesn't count towards the stall timeout
+						if (uploadThrottled)
+						{
+							trackedUpload.LastProgress = std::chrono::steady_clock::now();
+						}
+
+						if (stallTimeout.count() && (std::chrono::steady_clock::now() - trackedUpload.LastProgress > GetUploadStallTimeout(stallTimeout, trackedUpload.FileSize, expectedRate)))
+						{
+							stalled.push_back(upload);
+						}
+						else
+						{
+							inFlightCount++;
+						}
+					}
+				}
+
+				if (bundleCompleted)
+				{
+					SyncPackedUploads();
+				}
+				transaction.commit();
+			}
+			// Rows no longer uploading drop out of tracking
+			_uploadTracking = std::move(tracking);
+
+			for (const auto& siaPath : removed)
+			{
+				HandleFileRemove(siaCurl, siaPath);
+			}
+
+			// Partial uploads are deleted from Sia and queued again from the start
+			for (const auto& upload : stalled)
+			{
+				const SString& siaPath = upload.first;
+				const SString& filePath = upload.second;
+				const UploadTrackingData stalledUpload = _uploadTracking[siaPath];
+
+				json response;
+				if (ApiSuccess(siaCurl.Post(SString(L"/renter/delete/") + siaPath, {}, response)))
+				{
+					SQLite::Statement& update = GetStatement(UPDATE_STATUS);
+					update.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+					update.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+					if (update.exec() == 1)
+					{
+						CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(UploadStalled(siaPath, filePath, stalledUpload.UploadedBytes, stalledUpload.FileSize)));
+						_uploadTracking.erase(siaPath);
+					}
+					else
+					{
+						CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(ModifyUploadStatusFailed(siaPath, filePath, UploadStatus::Queued, update.getErrorMsg())));
+					}
+				}
+				else
+				{
+					// Still uploading as far as the database is concerned - retried on the next pass
+					inFlightCount++;
+				}
+			}
+
+			// Files left unchanged for the quiet period are ready to upload
+			{
+				SQLite::Statement& promote = GetStatement(PROMOTE_PENDING_UPLOADS);
+				promote.bind("@queued_status", static_cast<unsigned>(UploadStatus::Queued));
+				promote.bind("@pending_status", static_cast<unsigned>(UploadStatus::Pending));
+				promote.bind("@modified_time", static_cast<long long>(GetModifiedTime() - siaDriveConfig->GetUploadQuietPeriodSecs()));
+				promote.exec();
+			}
+
+			// Fill free slots in the configured order, admitting only as many uploads as the bandwidth policy allows
+			_bandwidthPolicy.Consume(BandwidthDirection::Upload, uploadedBytes);
+			_bandwidthPolicy.Update(siaDriveConfig);
+			const std::uint64_t maxUploadCount = _bandwidthPolicy.GetAdmissionCount(BandwidthDirection::Upload, inFlightCount, _siaDriveConfig->GetMaxUploadCount());
+			if (inFlightCount < maxUploadCount)
+			{
+				uploads = GetNextUploads(UploadOrderPolicyFromString(siaDriveConfig->GetUploadOrderPolicy()), maxUploadCount - inFlightCount, siaDriveConfig->GetEnableSmallFilePacking() ? siaDriveConfig->GetSmallFileThresholdBytes() : 0);
+				for (const auto& upload : uploads)
+				{
+					const SString& siaPath = upload.first;
+					const SString& filePath = upload.second;
+
+					// An earlier delete of the same path must finish first so it can't remove the new upload
+					if (IsRemovalPending(siaPath))
+					{
+						continue;
+					}
+
+					json response;
+					SiaCurlError cerror = siaCurl.Post(SString(L"/renter/upload/") + siaPath, { {L"source", filePath} }, response);
+					if (ApiSuccess(cerror))
+					{
+						SET_STATUS(UploadStatus::Uploading, UploadToSiaStarted, ModifyUploadStatusFailed)
+						if (statusUpdated)
+						{
+							inFlightCount++;
+						}
+					}
+				}
+			}
+
+			SQLite::Statement& count = GetStatement(QUERY_UPLOAD_COUNT_BY_STATUS);
+			count.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+			const std::uint64_t queueDepth = count.executeStep() ? count.getColumn(0).getInt64() : 0;
+			const std::uint64_t queuedBytes = queueDepth ? count.getColumn(1).getInt64() : 0;
+			count.reset();
+			count.bind("@status", static_cast<unsigned>(UploadStatus::Pending));
+			_pendingCount = count.executeStep() ? count.getColumn(0).getInt64() : 0;
+			count.reset();
+			UpdateMetrics(queueDepth, inFlightCount, completedBytes);
+			UpdateUploadProgress(queuedBytes);
+			// Only rows that could start now, or pending rows that come due within the quiet period, keep polling fast.
+			//	In-flight uploads hold the interval at the default so completions free their slot and progress is sampled.
+			SetWorkPending((queueDepth && (inFlightCount < maxUploadCount)) || _pendingCount, inFlightCount != 0);
+		}
+		// else error condition - host down?
+	}
+	catch (const SQLite::Exception& e)
+	{
+		// error condition - database not initialized (i.e. no table)?
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("AutoThreadCallback", e)));
+	}
+}
+
 UploadStatus CUploadManager::GetUploadStatus(const SString& siaPath)
 {
 	UploadStatus uploadStatus = UploadStatus::NotFound;
 
-	SQLite::Statement query(_uploadDatabase, QUERY_UPLOADS_BY_SIA_PATH);
+	std::lock_guard<std::mutex> l(_uploadMutex);
+	SQLite::Statement& query = GetStatement(QUERY_UPLOADS_BY_SIA_PATH);
 	query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
 	if (query.executeStep())
 	{
 		uploadStatus = static_cast<UploadStatus>(static_cast<unsigned>(query.getColumn(query.getColumnIndex("status"))));
 	}
+	query.reset();
 
 	return uploadStatus;
 }
 
-UploadError CUploadManager::AddOrUpdate(const SString& siaPath, SString filePath)
+// Callers must hold _uploadMutex - size and hash are taken beforehand so hashing doesn't block the scheduler
+UploadError CUploadManager::AddOrUpdateLocked(const SString& siaPath, const SString& filePath, const std::uint64_t& fileSize, const SString& contentHash)
 {
-  UploadError ret;
-
-	// Relative to absolute and grab parent folder of source
-	FilePath rootPath = filePath;
-  rootPath.MakeAbsolute().RemoveFileName();
-
+	UploadError ret;
 	if (FilePath(filePath).IsFile())
 	{
-		// Lock here - if file is modified again before a prior upload is complete, delete it and 
-		//	start again later
-		std::lock_guard<std::mutex> l(_uploadMutex);
-
 		try
 		{
-			SQLite::Statement query(_uploadDatabase, QUERY_UPLOADS_BY_SIA_PATH_AND_STATUS);
+			SQLite::Statement& query = GetStatement(QUERY_UPLOADS_BY_SIA_PATH);
 			query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
-			query.bind("@status", static_cast<unsigned>(UploadStatus::Uploading));
 
-			// Check uploading
+			// Uploads that haven't started yet absorb the change and restart the quiet period. Content that's
+			//	unchanged from what's on (or going to) Sia is skipped - anything else has to be removed first.
       bool addToDatabase = true;
 			if (query.executeStep())
 			{
 				UploadStatus uploadStatus = static_cast<UploadStatus>(static_cast<unsigned>(query.getColumn(query.getColumnIndex("status"))));
-				if (uploadStatus == UploadStatus::Uploading)
+				const SString previousHash = static_cast<const char*>(query.getColumn(query.getColumnIndex("content_hash")));
+				const std::uint64_t previousSize = query.getColumn(query.getColumnIndex("file_size")).getInt64();
+				query.reset();
+				if (((uploadStatus == UploadStatus::Complete) || (uploadStatus == UploadStatus::Uploading)) && contentHash.Length() && (previousHash == contentHash) && (previousSize == fileSize))
 				{
-          addToDatabase = HandleFileRemove(CSiaCurl(GetHostConfig()), siaPath);
+          addToDatabase = false;
+					_dedupBytesSaved += fileSize;
+					CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(UploadSkippedUnchanged(siaPath, filePath, fileSize)));
 				}
-        else if (uploadStatus == UploadStatus::Queued)
-        {
+				else if ((uploadStatus == UploadStatus::Pending) || (uploadStatus == UploadStatus::Queued))
+				{
           addToDatabase = false;
-        }
+
+					SQLite::Statement& update = GetStatement(UPDATE_PENDING_UPLOAD);
+					update.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+					update.bind("@file_path", SString::ToUtf8(filePath).c_str());
+					update.bind("@status", static_cast<unsigned>(UploadStatus::Pending));
+					update.bind("@file_size", static_cast<long long>(fileSize));
+					update.bind("@modified_time", static_cast<long long>(GetModifiedTime()));
+					update.bind("@content_hash", SString::ToUtf8(contentHash).c_str());
+					if (update.exec() == 1)
+					{
+						CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(UploadCoalesced(siaPath, filePath, ++_avoidedUploadCount)));
+					}
+					else
+					{
+						CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(ModifyUploadStatusFailed(siaPath, filePath, UploadStatus::Pending, update.getErrorMsg())));
+						ret = UploadErrorCode::DatabaseError;
+					}
+				}
+				else
+				{
+          addToDatabase = HandleFileRemove(CSiaCurl(GetHostConfig()), siaPath);
+				}
 			}
 			
       if (addToDatabase)
@@ -295,10 +1070,26 @@ UploadError CUploadManager::AddOrUpdate(const SString& siaPath, SString filePath
 				// Add to db
 				try
 				{
-					SQLite::Statement insert(_uploadDatabase, INSERT_UPLOAD);
+					// Inherit the priority of the nearest folder that has one
+					std::int32_t priority = 0;
+					{
+						SQLite::Statement& folderPriority = GetStatement(QUERY_FOLDER_PRIORITY);
+						folderPriority.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+						if (folderPriority.executeStep())
+						{
+							priority = folderPriority.getColumn(0).getInt();
+						}
+						folderPriority.reset();
+					}
+
+					SQLite::Statement& insert = GetStatement(INSERT_UPLOAD);
 					insert.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
 					insert.bind("@file_path", SString::ToUtf8(filePath).c_str());
-					insert.bind("@status", static_cast<unsigned>(UploadStatus::Queued));
+					insert.bind("@status", static_cast<unsigned>(UploadStatus::Pending));
+					insert.bind("@file_size", static_cast<long long>(fileSize));
+					insert.bind("@priority", priority);
+					insert.bind("@modified_time", static_cast<long long>(GetModifiedTime()));
+					insert.bind("@content_hash", SString::ToUtf8(contentHash).c_str());
 					if (insert.exec() == 1)
 					{
 						CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(FileAddedToQueue(siaPath, filePath)));
@@ -331,15 +1122,210 @@ UploadError CUploadManager::AddOrUpdate(const SString& siaPath, SString filePath
 	return ret;
 }
 
+// Callers must hold _uploadMutex. Only content that may match what's already on (or going to) Sia is worth
+//	hashing on the close path - everything else is hashed by the scheduler before it's queued.
+bool CUploadManager::IsContentHashNeeded(const SString& siaPath, const std::uint64_t& fileSize)
+{
+	bool ret = false;
+	try
+	{
+		SQLite::Statement& query = GetStatement(QUERY_UPLOADS_BY_SIA_PATH);
+		query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+		if (query.executeStep())
+		{
+			const UploadStatus uploadStatus = static_cast<UploadStatus>(static_cast<unsigned>(query.getColumn(query.getColumnIndex("status"))));
+			const SString previousHash = static_cast<const char*>(query.getColumn(query.getColumnIndex("content_hash")));
+			ret = ((uploadStatus == UploadStatus::Complete) || (uploadStatus == UploadStatus::Uploading)) && previousHash.Length() &&
+				(static_cast<std::uint64_t>(query.getColumn(query.getColumnIndex("file_size")).getInt64()) == fileSize);
+		}
+		query.reset();
+	}
+	catch (SQLite::Exception e)
+	{
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("IsContentHashNeeded", e)));
+	}
+
+	return ret;
+}
+
+// Hashes pending files whose quiet period has elapsed so they're queued with a content hash. Files are read
+//	without holding _uploadMutex - a row modified in the meantime keeps its empty hash and is retried.
+void CUploadManager::HashDueUploads(CSiaDriveConfig* siaDriveConfig)
+{
+	std::vector<std::pair<std::pair<SString, SString>, std::int64_t>> uploads;
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		SQLite::Statement& query = GetStatement(QUERY_UNHASHED_DUE_UPLOADS);
+		query.bind("@status", static_cast<unsigned>(UploadStatus::Pending));
+		query.bind("@modified_time", static_cast<long long>(GetModifiedTime() - siaDriveConfig->GetUploadQuietPeriodSecs()));
+		while (query.executeStep())
+		{
+			uploads.push_back({ { static_cast<const char*>(query.getColumn(0)), static_cast<const char*>(query.getColumn(1)) }, query.getColumn(2).getInt64() });
+		}
+		query.reset();
+	}
+
+	std::vector<SString> contentHashes;
+	contentHashes.reserve(uploads.size());
+	for (const auto& upload : uploads)
+	{
+		contentHashes.push_back(GenerateFileHash(upload.first.second));
+	}
+
+	if (!uploads.empty())
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		SQLite::Transaction transaction(_uploadDatabase);
+		SQLite::Statement& update = GetStatement(UPDATE_PENDING_HASH);
+		for (std::size_t i = 0; i < uploads.size(); i++)
+		{
+			update.bind("@sia_path", SString::ToUtf8(uploads[i].first.first).c_str());
+			update.bind("@content_hash", SString::ToUtf8(contentHashes[i]).c_str());
+			update.bind("@status", static_cast<unsigned>(UploadStatus::Pending));
+			update.bind("@modified_time", static_cast<long long>(uploads[i].second));
+			update.exec();
+			update.reset();
+		}
+		transaction.commit();
+	}
+}
+
+UploadError CUploadManager::AddOrUpdate(const SString& siaPath, SString filePath)
+{
+	const std::uint64_t fileSize = GetSourceFileSize(filePath);
+	bool hashNeeded;
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		hashNeeded = IsContentHashNeeded(siaPath, fileSize);
+	}
+	const SString contentHash = hashNeeded ? GenerateFileHash(filePath) : SString();
+
+	// Lock here - if file is modified again before a prior upload is complete, delete it and 
+	//	start again later
+	std::lock_guard<std::mutex> l(_uploadMutex);
+	UploadError ret = AddOrUpdateLocked(siaPath, filePath, fileSize, contentHash);
+	if (ApiSuccess(ret))
+	{
+		Wake();
+	}
+
+	return ret;
+}
+
+// Bulk enqueue in a single transaction - returns the last failure, if any
+UploadError CUploadManager::AddOrUpdate(const std::vector<std::pair<SString, SString>>& uploads)
+{
+	UploadError ret;
+	std::vector<std::pair<std::uint64_t, SString>> contents;
+	contents.reserve(uploads.size());
+	for (const auto& upload : uploads)
+	{
+		contents.push_back({ GetSourceFileSize(upload.second), SString() });
+	}
+
+	std::vector<bool> hashNeeded(uploads.size());
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		for (std::size_t i = 0; i < uploads.size(); i++)
+		{
+			hashNeeded[i] = IsContentHashNeeded(uploads[i].first, contents[i].first);
+		}
+	}
+
+	for (std::size_t i = 0; i < uploads.size(); i++)
+	{
+		if (hashNeeded[i])
+		{
+			contents[i].second = GenerateFileHash(uploads[i].second);
+		}
+	}
+
+	std::lock_guard<std::mutex> l(_uploadMutex);
+	try
+	{
+		SQLite::Transaction transaction(_uploadDatabase);
+		for (std::size_t i = 0; i < uploads.size(); i++)
+		{
+			const auto& upload = uploads[i];
+			UploadError error = AddOrUpdateLocked(upload.first, upload.second, contents[i].first, contents[i].second);
+			if (!ApiSuccess(error))
+			{
+				ret = error;
+			}
+		}
+		transaction.commit();
+		Wake();
+	}
+	catch (SQLite::Exception e)
+	{
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("AddOrUpdate(commit)", e)));
+		ret = { UploadErrorCode::DatabaseError, e.getErrorStr() };
+	}
+
+	return ret;
+}
+
+// Called from the drive while files are opened and closed, so siad isn't waited on: the row is dropped right away
+//	and the file deleted from Sia in the background. Rows that never reached Sia and packed files are dropped locally.
 UploadError CUploadManager::Remove(const SString& siaPath)
 {
   UploadError ret;
 	try
 	{
 	  std::lock_guard<std::mutex> l(_uploadMutex);
-		if (!HandleFileRemove(CSiaCurl(GetHostConfig()), siaPath))
+		bool onSia = true;
 		{
-      ret = UploadErrorCode::SourceFileNotFound;
+			SQLite::Statement& query = GetStatement(QUERY_UPLOADS_BY_SIA_PATH);
+			query.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+			if (query.executeStep())
+			{
+				const UploadStatus uploadStatus = static_cast<UploadStatus>(static_cast<unsigned>(query.getColumn(query.getColumnIndex("status"))));
+				onSia = (uploadStatus == UploadStatus::Uploading) || (uploadStatus == UploadStatus::Complete);
+			}
+			query.reset();
+		}
+
+		// Packed files only exist inside their bundle - HandleFileRemove() doesn't go to siad for them
+		const bool packed = _uploadBundler->IsMember(siaPath);
+		if (packed)
+		{
+			if (!HandleFileRemove(CSiaCurl(GetHostConfig()), siaPath))
+			{
+				ret = UploadErrorCode::SourceFileNotFound;
+			}
+		}
+		else
+		{
+			SQLite::Statement& del = GetStatement(DELETE_UPLOAD);
+			del.bind("@sia_path", SString::ToUtf8(siaPath).c_str());
+			del.exec();
+		}
+
+		if (!packed && onSia)
+		{
+			{
+				std::lock_guard<std::mutex> l2(_pendingRemovals->Mutex);
+				_pendingRemovals->SiaPaths.insert(siaPath.str());
+			}
+
+			const FilePath removeFilePath(GetSiaDriveConfig()->GetCacheFolder(), siaPath);
+			auto pendingRemovals = _pendingRemovals;
+			CSiaCurl(GetHostConfig()).PostAsync(SString(L"/renter/delete/") + siaPath, {}, [pendingRemovals, siaPath, removeFilePath](const SiaCurlResult& curlResult)
+			{
+				{
+					std::lock_guard<std::mutex> l(pendingRemovals->Mutex);
+					pendingRemovals->SiaPaths.erase(siaPath.str());
+				}
+
+				if (ApiSuccess(curlResult.Error))
+				{
+					CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(FileRemovedFromSia(siaPath, removeFilePath)));
+				}
+				else
+				{
+					CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(FailedToRemoveFileFromSia(siaPath, removeFilePath, curlResult.Error)));
+				}
+			});
 		}
 	}
   catch (SQLite::Exception e)
@@ -349,4 +1335,88 @@ UploadError CUploadManager::Remove(const SString& siaPath)
 	}
 
 	return ret;
-}
\ No newline at end of file
+}
+
+bool CUploadManager::IsRemovalPending(const SString& siaPath)
+{
+	std::lock_guard<std::mutex> l(_pendingRemovals->Mutex);
+	return (_pendingRemovals->SiaPaths.find(siaPath.str()) != _pendingRemovals->SiaPaths.end());
+}
+
+// Uploads under 'siaFolder' (and its sub-folders without a priority of their own) are started
+//	ahead of lower priorities by the priority and fair share policies. Priority 0 removes the setting.
+UploadError CUploadManager::SetFolderPriority(const SString& siaFolder, const std::int32_t& priority)
+{
+	UploadError ret;
+
+	SString folder = CSiaApi::FormatToSiaPath(siaFolder);
+	while (folder.Length() && (folder[folder.Length() - 1] == '/'))
+	{
+		folder = folder.SubString(0, folder.Length() - 1);
+	}
+
+	try
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		SQLite::Transaction transaction(_uploadDatabase);
+		if (priority)
+		{
+			SQLite::Statement& upsert = GetStatement(UPSERT_FOLDER_PRIORITY);
+			upsert.bind("@folder", SString::ToUtf8(folder).c_str());
+			upsert.bind("@priority", priority);
+			upsert.exec();
+		}
+		else
+		{
+			SQLite::Statement& del = GetStatement(DELETE_FOLDER_PRIORITY);
+			del.bind("@folder", SString::ToUtf8(folder).c_str());
+			del.exec();
+		}
+
+		SQLite::Statement& update = GetStatement(UPDATE_PRIORITY_FOR_FOLDER);
+		update.bind("@folder", SString::ToUtf8(folder).c_str());
+		update.exec();
+		transaction.commit();
+	}
+	catch (SQLite::Exception e)
+	{
+		CEventSystem::EventSystem.NotifyEvent(CreateSystemEvent(DatabaseExceptionOccurred("SetFolderPriority", e)));
+		ret = { UploadErrorCode::DatabaseError, e.getErrorStr() };
+	}
+
+	return ret;
+}
+
+// Called for every path not found on Sia, so it's answered from memory instead of taking _uploadMutex
+bool CUploadManager::IsPackedFile(const SString& siaPath)
+{
+	return _uploadBundler->IsMember(siaPath);
+}
+
+// Copies a packed file out of its bundle, downloading the bundle first if it's no longer local
+bool CUploadManager::ExtractPackedFile(const SString& siaPath, const SString& destFilePath, std::uint64_t& downloadedBytes)
+{
+	downloadedBytes = 0;
+	CUploadBundler::MemberData member;
+	{
+		std::lock_guard<std::mutex> l(_uploadMutex);
+		if (!_uploadBundler->GetMember(siaPath, member))
+		{
+			return false;
+		}
+	}
+
+	return DownloadBundle(CSiaCurl(GetHostConfig()), member.Bundle, downloadedBytes) && CUploadBundler::ExtractMember(member, destFilePath);
+}
+
+std::vector<CUploadManager::UploadProgressData> CUploadManager::GetUploadProgress()
+{
+	std::lock_guard<std::mutex> l(_progressMutex);
+	return _uploadProgress;
+}
+
+CUploadManager::UploadProgressData CUploadManager::GetTotalUploadProgress()
+{
+	std::lock_guard<std::mutex> l(_progressMutex);
+	return _totalUploadProgress;
+}
@@ -0,0 +1,369 @@
+#include <siacommon.h>
+#include <filepath.h>
+#include <globmatcher.h>
+#include <siafilestore.h>
+#include <parallelfiledecoder.h>
+#include <siacurl.h>
+#include <siadriveconfig.h>
+#include <uploadmanager.h>
+#include <fstream>
+#include <regex>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace Sia::Api;
+
+// Console benchmarks for the hot paths of the API library. Each benchmark prints one line per measurement;
+//	pass benchmark names on the command line to run a subset. Numbers are only meaningful for Release builds.
+
+#define GLOB_BENCH_PATH_COUNT 100000
+#define GLOB_BENCH_FORMAT_COUNT 100000
+#define STORE_BENCH_FILE_COUNT 1000000
+#define STORE_BENCH_SCAN_COUNT 10
+#define DECODE_BENCH_FILE_COUNT 500000
+#define UPLOAD_BENCH_ROW_COUNT 100000
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double ElapsedMs(const BenchClock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+static void PrintResult(const char* name, const std::uint64_t& count, const double& elapsedMs)
+{
+	const double opsPerSecond = (elapsedMs > 0.0) ? (static_cast<double>(count) * 1000.0 / elapsedMs) : 0.0;
+	printf("%-40s %10llu ops %10.1f ms %14.0f ops/s\n", name, static_cast<unsigned long long>(count), elapsedMs, opsPerSecond);
+}
+
+// Sia_FindFiles-style query and FormatToSiaPath, each against the std::wregex version it replaced
+static void BenchGlobMatcher()
+{
+	std::vector<SString> paths;
+	paths.reserve(GLOB_BENCH_PATH_COUNT);
+	for (std::uint32_t i = 0; i < GLOB_BENCH_PATH_COUNT; i++)
+	{
+		paths.push_back(L"folder" + SString::FromUInt32(i % 100) + L"/sub" + SString::FromUInt32(i % 7) + L"/file" + SString::FromUInt32(i) + L".dat");
+	}
+	const SString query = L"folder7/sub?/*.dat";
+
+	std::uint64_t matches = 0;
+	auto start = BenchClock::now();
+	{
+		SString regexQuery = query;
+		regexQuery.Replace(".", "\\.").Replace("*", "[^/]+").Replace("?", "[^/]?");
+		std::wregex r(regexQuery.str());
+		for (const auto& path : paths)
+		{
+			matches += std::regex_match(path.str(), r) ? 1 : 0;
+		}
+	}
+	PrintResult("glob: query (std::wregex)", paths.size(), ElapsedMs(start));
+
+	start = BenchClock::now();
+	{
+		CGlobMatcherPtr matcher = CGlobMatcher::Get(query);
+		for (const auto& path : paths)
+		{
+			matches += matcher->IsMatch(path) ? 1 : 0;
+		}
+	}
+	PrintResult("glob: query (CGlobMatcher)", paths.size(), ElapsedMs(start));
+
+	const SString dokanPath = L"\\folder7\\\\sub3//file7.dat";
+	std::uint64_t length = 0;
+	start = BenchClock::now();
+	for (std::uint32_t i = 0; i < GLOB_BENCH_FORMAT_COUNT; i++)
+	{
+		SString path = dokanPath;
+		path.Replace('\\', '/');
+		std::wregex r(L"/+");
+		path = std::regex_replace(path.str(), r, L"/");
+		length += path.Length();
+	}
+	PrintResult("glob: format path (std::wregex)", GLOB_BENCH_FORMAT_COUNT, ElapsedMs(start));
+
+	start = BenchClock::now();
+	for (std::uint32_t i = 0; i < GLOB_BENCH_FORMAT_COUNT; i++)
+	{
+		length += FilePath::NormalizeSeparators(dokanPath, '/').Length();
+	}
+	PrintResult("glob: format path (NormalizeSeparators)", GLOB_BENCH_FORMAT_COUNT, ElapsedMs(start));
+
+	printf("glob: %llu matches, %llu characters\n", static_cast<unsigned long long>(matches), static_cast<unsigned long long>(length));
+}
+
+// Per-file heap object with the members _CSiaFile had before CSiaFileStore - the baseline for the store
+class CBenchHeapFile
+{
+public:
+	CBenchHeapFile(const void* siaCurl, const void* siaDriveConfig, const SString& siaPath, const std::uint64_t& fileSize) :
+		_siaCurl(siaCurl),
+		_siaDriveConfig(siaDriveConfig),
+		_siaPath(siaPath),
+		_fileSize(fileSize),
+		_available(true),
+		_renewing(true),
+		_redundancy(3),
+		_uploadProgress(100),
+		_expiration(0)
+	{
+	}
+
+public:
+	virtual ~CBenchHeapFile()
+	{
+	}
+
+private:
+	const void* _siaCurl;
+	const void* _siaDriveConfig;
+	SString _siaPath;
+	std::uint64_t _fileSize;
+	bool _available;
+	bool _renewing;
+	std::uint32_t _redundancy;
+	std::uint32_t _uploadProgress;
+	std::uint32_t _expiration;
+
+public:
+	inline const SString& GetSiaPath() const { return _siaPath; }
+	inline const std::uint64_t& GetFileSize() const { return _fileSize; }
+	inline bool GetAvailable() const { return _available; }
+};
+
+static std::string CreateBenchSiaPath(const std::uint32_t& i)
+{
+	return "renter/folder" + std::to_string(i % 1000) + "/sub" + std::to_string(i % 13) + "/file" + std::to_string(i) + ".dat";
+}
+
+// Build, footprint, column scan and path lookup at STORE_BENCH_FILE_COUNT files. The heap object footprint
+//	is estimated from object, path and shared_ptr control block sizes.
+static void BenchFileStore()
+{
+	std::uint64_t total = 0;
+	{
+		auto start = BenchClock::now();
+		std::vector<std::shared_ptr<CBenchHeapFile>> heapFiles;
+		std::size_t heapBytes = 0;
+		for (std::uint32_t i = 0; i < STORE_BENCH_FILE_COUNT; i++)
+		{
+			heapFiles.push_back(std::make_shared<CBenchHeapFile>(nullptr, nullptr, SString::FromUtf8(CreateBenchSiaPath(i)), i));
+			heapBytes += sizeof(std::shared_ptr<CBenchHeapFile>) + sizeof(CBenchHeapFile) + (2 * sizeof(void*)) +
+				(heapFiles.back()->GetSiaPath().str().capacity() + 1) * sizeof(SString::SChar);
+		}
+		PrintResult("store: build (heap objects)", STORE_BENCH_FILE_COUNT, ElapsedMs(start));
+		printf("store: heap objects ~%llu MB, ~%llu bytes/file\n", static_cast<unsigned long long>(heapBytes >> 20), static_cast<unsigned long long>(heapBytes / STORE_BENCH_FILE_COUNT));
+
+		start = BenchClock::now();
+		for (std::uint32_t j = 0; j < STORE_BENCH_SCAN_COUNT; j++)
+		{
+			for (const auto& heapFile : heapFiles)
+			{
+				total += heapFile->GetAvailable() ? heapFile->GetFileSize() : 0;
+			}
+		}
+		PrintResult("store: scan (heap objects)", static_cast<std::uint64_t>(STORE_BENCH_FILE_COUNT) * STORE_BENCH_SCAN_COUNT, ElapsedMs(start));
+	}
+
+	CSiaFileStore fileStore;
+	auto start = BenchClock::now();
+	for (std::uint32_t i = 0; i < STORE_BENCH_FILE_COUNT; i++)
+	{
+		fileStore.Add(CreateBenchSiaPath(i), i, true, true, 3, 100, 0);
+	}
+	fileStore.Seal();
+	PrintResult("store: build (CSiaFileStore)", STORE_BENCH_FILE_COUNT, ElapsedMs(start));
+	printf("store: CSiaFileStore %llu MB, %llu bytes/file\n", static_cast<unsigned long long>(fileStore.GetMemoryUsage() >> 20), static_cast<unsigned long long>(fileStore.GetMemoryUsage() / STORE_BENCH_FILE_COUNT));
+
+	start = BenchClock::now();
+	for (std::uint32_t j = 0; j < STORE_BENCH_SCAN_COUNT; j++)
+	{
+		for (std::uint32_t i = 0; i < fileStore.GetCount(); i++)
+		{
+			total += fileStore.GetAvailable(i) ? fileStore.GetFileSize(i) : 0;
+		}
+	}
+	PrintResult("store: scan (CSiaFileStore)", static_cast<std::uint64_t>(STORE_BENCH_FILE_COUNT) * STORE_BENCH_SCAN_COUNT, ElapsedMs(start));
+
+	std::vector<std::string> siaPaths;
+	siaPaths.reserve(STORE_BENCH_FILE_COUNT);
+	for (std::uint32_t i = 0; i < STORE_BENCH_FILE_COUNT; i++)
+	{
+		siaPaths.push_back(CreateBenchSiaPath((i * 7919) % STORE_BENCH_FILE_COUNT));
+	}
+
+	std::uint64_t found = 0;
+	start = BenchClock::now();
+	for (const auto& siaPath : siaPaths)
+	{
+		std::uint32_t index;
+		found += fileStore.Find(siaPath, index) ? 1 : 0;
+	}
+	PrintResult("store: find (CSiaFileStore)", siaPaths.size(), ElapsedMs(start));
+
+	printf("store: %llu found, %llu total bytes\n", static_cast<unsigned long long>(found), static_cast<unsigned long long>(total));
+}
+
+// Decode of a DECODE_BENCH_FILE_COUNT-entry /renter/files listing with 1, 2, 4 and 8 workers. Elements are
+//	raw json as handed over by CJsonArrayStream; timing covers decode and the merge into the store.
+static void BenchFileDecoder()
+{
+	std::vector<std::string> elements;
+	elements.reserve(DECODE_BENCH_FILE_COUNT);
+	for (std::uint32_t i = 0; i < DECODE_BENCH_FILE_COUNT; i++)
+	{
+		json file = {
+			{ "siapath", CreateBenchSiaPath(i) },
+			{ "filesize", static_cast<std::uint64_t>(i) * 4096 },
+			{ "available", true },
+			{ "renewing", true },
+			{ "redundancy", 3 },
+			{ "uploadprogress", 100 },
+			{ "expiration", 150000 }
+		};
+		elements.push_back(file.dump());
+	}
+
+	printf("decode: %d default workers, %u hardware threads\n", CParallelFileDecoder::GetDefaultWorkerCount(), std::thread::hardware_concurrency());
+	for (int workerCount = 1; workerCount <= 8; workerCount *= 2)
+	{
+		std::vector<std::string> listing = elements;
+		CSiaFileStore fileStore;
+
+		auto start = BenchClock::now();
+		bool success;
+		{
+			CParallelFileDecoder fileDecoder(workerCount);
+			for (auto& element : listing)
+			{
+				fileDecoder.Push(element);
+			}
+			success = fileDecoder.Finish(fileStore);
+		}
+		const double elapsedMs = ElapsedMs(start);
+
+		const std::string name = "decode: " + std::to_string(workerCount) + " worker(s)";
+		PrintResult(name.c_str(), fileStore.GetCount(), elapsedMs);
+		if (!success)
+		{
+			printf("decode: failed with %d worker(s)\n", workerCount);
+		}
+	}
+}
+
+// Enqueue and transition UPLOAD_BENCH_ROW_COUNT upload rows in a scratch database: bulk enqueue, re-enqueue
+//	(coalesced into the pending rows), status lookup and removal. siad is pointed at a closed port, so rows stay
+//	local and removal never leaves the machine. Every row shares one source file.
+static void BenchUploadManager()
+{
+	FilePath benchFolder(FilePath::GetTempDirectory(), L"siadrive_bench");
+	benchFolder.CreateDirectory();
+
+	const FilePath uploadDbFilePath(benchFolder, L"renter_upload.db3");
+	for (const auto& suffix : { L"", L"-wal", L"-shm" })
+	{
+		FilePath(static_cast<SString>(uploadDbFilePath) + suffix).DeleteFile();
+	}
+
+	const FilePath configFilePath(benchFolder, L"siadriveconfig.json");
+	json configDocument = {
+		{ "Renter_UploadDbFilePath", SString::ToUtf8(static_cast<SString>(uploadDbFilePath)) },
+		{ "HostNameOrIp", "127.0.0.1" },
+		{ "HostPort", 1 }
+	};
+	std::ofstream(SString::ToUtf8(static_cast<SString>(configFilePath)).c_str()) << configDocument << std::endl;
+
+	const FilePath sourceFilePath(benchFolder, L"source.dat");
+	std::ofstream(SString::ToUtf8(static_cast<SString>(sourceFilePath)).c_str()) << "siadrive.bench";
+
+	std::vector<std::pair<SString, SString>> uploads;
+	uploads.reserve(UPLOAD_BENCH_ROW_COUNT);
+	for (std::uint32_t i = 0; i < UPLOAD_BENCH_ROW_COUNT; i++)
+	{
+		uploads.push_back({ SString::FromUtf8(CreateBenchSiaPath(i)), static_cast<SString>(sourceFilePath) });
+	}
+
+	CSiaCurl::Startup();
+	{
+		// Debug builds reset the configuration on load - never run against the default upload database
+		CSiaDriveConfig siaDriveConfig(static_cast<SString>(configFilePath));
+		if (SString(siaDriveConfig.GetRenter_UploadDbFilePath()) != static_cast<SString>(uploadDbFilePath))
+		{
+			printf("upload: skipped, scratch configuration was not loaded\n");
+			CSiaCurl::Shutdown();
+			return;
+		}
+
+		SiaHostConfig hostConfig;
+		hostConfig.HostName = siaDriveConfig.GetHostNameOrIp();
+		hostConfig.HostPort = siaDriveConfig.GetHostPort();
+		hostConfig.RequiredVersion = COMPAT_SIAD_VERSION;
+		hostConfig.VersionCacheTtlSecs = siaDriveConfig.GetVersionCacheTtlSecs();
+		CSiaCurl siaCurl(hostConfig);
+		CUploadManager uploadManager(siaCurl, &siaDriveConfig);
+
+		auto start = BenchClock::now();
+		bool success = ApiSuccess(uploadManager.AddOrUpdate(uploads));
+		PrintResult("upload: enqueue", uploads.size(), ElapsedMs(start));
+
+		start = BenchClock::now();
+		success = ApiSuccess(uploadManager.AddOrUpdate(uploads)) && success;
+		PrintResult("upload: re-enqueue (coalesce)", uploads.size(), ElapsedMs(start));
+
+		std::uint64_t pending = 0;
+		start = BenchClock::now();
+		for (const auto& upload : uploads)
+		{
+			pending += (uploadManager.GetUploadStatus(upload.first) == UploadStatus::Pending) ? 1 : 0;
+		}
+		PrintResult("upload: status", uploads.size(), ElapsedMs(start));
+
+		start = BenchClock::now();
+		for (const auto& upload : uploads)
+		{
+			success = ApiSuccess(uploadManager.Remove(upload.first)) && success;
+		}
+		PrintResult("upload: remove", uploads.size(), ElapsedMs(start));
+
+		printf("upload: %llu pending, %s\n", static_cast<unsigned long long>(pending), success ? "no errors" : "errors reported");
+	}
+	CSiaCurl::Shutdown();
+}
+
+static bool IsSelected(const int& argc, char* argv[], const char* name)
+{
+	bool ret = (argc < 2);
+	for (int i = 1; !ret && (i < argc); i++)
+	{
+		ret = (strcmp(argv[i], name) == 0);
+	}
+
+	return ret;
+}
+
+int main(int argc, char* argv[])
+{
+	if (IsSelected(argc, argv, "glob"))
+	{
+		BenchGlobMatcher();
+	}
+
+	if (IsSelected(argc, argv, "store"))
+	{
+		BenchFileStore();
+	}
+
+	if (IsSelected(argc, argv, "decode"))
+	{
+		BenchFileDecoder();
+	}
+
+	if (IsSelected(argc, argv, "upload"))
+	{
+		BenchUploadManager();
+	}
+
+	return 0;
+}
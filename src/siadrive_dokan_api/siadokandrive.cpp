@@ -7,6 +7,9 @@
 using namespace Sia::Api;
 using namespace Sia::Api::Dokan;
 
+// Downloads wait at most this long for bandwidth - well inside the timeout given to Dokan
+#define DOWNLOAD_ADMISSION_TIMEOUT_MS (1000 * 60 * 2)
+
 static __int64 FileSize(const wchar_t* name)
 {
   struct _stat64 buf;
@@ -44,8 +47,7 @@ private:
 	static FilePath _cacheLocation;
 	static std::unique_ptr<std::thread> _fileListThread;
 	static HANDLE _fileListStopEvent;
-	static CSiaFileTreePtr _siaFileTree;
-	static std::mutex _fileTreeMutex;
+	static CAtomicSnapshot<CSiaFileTree> _siaFileTree;
 	static std::unique_ptr<std::thread> _mountThread;
 	static NTSTATUS _mountStatus;
 	static SString _mountPoint;
@@ -58,8 +60,7 @@ private:
 
   inline static CSiaFileTreePtr GetFileTree()
 	{
-    auto ret = _siaFileTree;
-    return ret;
+    return _siaFileTree.Load();
 	}
 
   static bool AddFileToCache(OpenFileInfo& openFileInfo, PDOKAN_FILE_INFO dokanFileInfo)
@@ -72,7 +73,26 @@ private:
       tempFilePath.Append(GenerateSha256(openFileInfo.SiaPath) + ".siatmp");
 
       // TODO Check cache size is large enough to hold new file
-      ret = ApiSuccess(_siaApi->GetRenter()->DownloadFile(openFileInfo.SiaPath, tempFilePath));
+      // Shaping only delays the download - reads must not fail because the bucket is overdrawn
+      _uploadManager->GetBandwidthPolicy().WaitForTokens(BandwidthDirection::Download, DOWNLOAD_ADMISSION_TIMEOUT_MS);
+      // Packed files are read back out of their bundle instead of being downloaded on their own - only
+      //  a bundle actually fetched from Sia is charged, extracting from a local copy costs nothing
+      std::uint64_t downloadedBytes = 0;
+      if (_uploadManager->IsPackedFile(openFileInfo.SiaPath))
+      {
+        ret = _uploadManager->ExtractPackedFile(openFileInfo.SiaPath, tempFilePath, downloadedBytes);
+      }
+      else
+      {
+        ret = ApiSuccess(_siaApi->GetRenter()->DownloadFile(openFileInfo.SiaPath, tempFilePath));
+        if (ret)
+        {
+          const __int64 fileSize = FileSize(&tempFilePath[0]);
+          downloadedBytes = (fileSize > 0) ? fileSize : 0;
+        }
+      }
+      _uploadManager->GetBandwidthPolicy().Consume(BandwidthDirection::Download, downloadedBytes);
+
       if (ret)
       {
         ::CloseHandle(openFileInfo.FileHandle);
@@ -178,15 +198,12 @@ private:
 	{
     if (force)
     {
-      _siaApi->GetRenter()->RefreshFileTree();
+      _siaApi->GetRenter()->RefreshFileTree(true);
     }
 
     CSiaFileTreePtr siaFileTree;
     _siaApi->GetRenter()->GetFileTree(siaFileTree);
-    {
-      std::lock_guard<std::mutex> l(_fileTreeMutex);
-      _siaFileTree = siaFileTree;
-    }
+    _siaFileTree.Store(siaFileTree);
 	}
 
 	// Dokan callbacks
@@ -305,9 +322,19 @@ private:
 					}
 					else
 					{
+						// Windows names are case-insensitive - continue with the casing stored on Sia
 						bool siaExists;
-						if (ApiSuccess(_siaApi->GetRenter()->FileExists(siaPath, siaExists)))
+						SString resolvedSiaPath;
+						if (ApiSuccess(_siaApi->GetRenter()->FileExistsIgnoreCase(siaPath, siaExists, resolvedSiaPath)))
 						{
+							if (siaExists)
+							{
+								siaPath = resolvedSiaPath;
+							}
+							else
+							{
+								siaExists = _uploadManager->IsPackedFile(siaPath);
+							}
               bool exists = siaExists || cacheFilePath.IsFile();
 						  // Operations on existing files that are requested to be truncated, overwritten or re-created
 							//	will first be deleted and then replaced if, after the file operation is done, the resulting file
@@ -531,7 +558,8 @@ private:
             else
             {
               bool exists;
-              if (!ApiSuccess(_siaApi->GetRenter()->FileExists(CSiaApi::FormatToSiaPath(FilePath(fileName, findData.cFileName)), exists)))
+              SString resolvedSiaPath;
+              if (!ApiSuccess(_siaApi->GetRenter()->FileExistsIgnoreCase(CSiaApi::FormatToSiaPath(FilePath(fileName, findData.cFileName)), exists, resolvedSiaPath)))
               {
                 ::FindClose(findHandle);
                 return STATUS_INVALID_DEVICE_STATE;
@@ -557,7 +585,8 @@ private:
             auto dirList = siaFileTree->QueryDirectories(siaDirQuery);
             for (auto& dir : dirList)
             {
-              if (dirs.find(dir) == dirs.end())
+              // Bundle objects are an implementation detail of small file packing
+              if ((dirs.find(dir) == dirs.end()) && !CUploadBundler::IsBundlePath(CSiaApi::FormatToSiaPath(FilePath(fileName, dir))))
               {
                 // Create cache sub-folder
                 FilePath subCachePath(cachePath, dir);
@@ -631,7 +660,7 @@ private:
 		NTSTATUS ret = STATUS_SUCCESS;
 
     auto siaFileTree = GetFileTree();
-    auto siaFile = siaFileTree ? siaFileTree->GetFile(openFileInfo->SiaPath) : nullptr;
+    auto siaFile = siaFileTree ? siaFileTree->GetFileIgnoreCase(openFileInfo->SiaPath) : nullptr;
 
     HANDLE tempHandle = openFileInfo->FileHandle;
 	  if (!siaFile && (!tempHandle || (tempHandle == INVALID_HANDLE_VALUE)))
@@ -1401,6 +1430,27 @@ public:
 	{
 		return (_siaApi != nullptr);
 	}
+
+	static bool SetUploadFolderPriority(const SString& siaFolder, const std::int32_t& priority)
+	{
+		return (_uploadManager && ApiSuccess(_uploadManager->SetFolderPriority(siaFolder, priority)));
+	}
+
+	static bool GetUploadProgress(std::uint64_t& activeCount, std::uint32_t& progress, std::uint64_t& bytesPerSecond, std::int64_t& etaSeconds)
+	{
+		bool ret = false;
+		if (_uploadManager)
+		{
+			const auto totalUploadProgress = _uploadManager->GetTotalUploadProgress();
+			activeCount = _uploadManager->GetInFlightCount();
+			progress = totalUploadProgress.FileSize ? static_cast<std::uint32_t>((totalUploadProgress.UploadedBytes * 100) / totalUploadProgress.FileSize) : 100;
+			bytesPerSecond = totalUploadProgress.BytesPerSecond;
+			etaSeconds = totalUploadProgress.EtaSeconds;
+			ret = true;
+		}
+
+		return ret;
+	}
 };
 // Static member variables
 std::mutex DokanImpl::_dokanMutex;
@@ -1411,8 +1461,7 @@ DOKAN_OPERATIONS DokanImpl::_dokanOps;
 DOKAN_OPTIONS DokanImpl::_dokanOptions;
 FilePath DokanImpl::_cacheLocation;
 HANDLE DokanImpl::_fileListStopEvent;
-CSiaFileTreePtr DokanImpl::_siaFileTree;
-std::mutex DokanImpl::_fileTreeMutex;
+CAtomicSnapshot<CSiaFileTree> DokanImpl::_siaFileTree;
 std::unique_ptr<std::thread> DokanImpl::_fileListThread;
 std::unique_ptr<std::thread> DokanImpl::_mountThread;
 NTSTATUS DokanImpl::_mountStatus = STATUS_SUCCESS;
@@ -1455,4 +1504,17 @@ void CSiaDokanDrive::Unmount(const bool& clearCache)
 void CSiaDokanDrive::ClearCache()
 {
 	std::lock_guard<std::mutex> l(DokanImpl::GetMutex());
-}
\ No newline at end of file
+}
+
+// Priority is stored in the upload database - the drive must be mounted
+bool CSiaDokanDrive::SetUploadFolderPriority(const SString& siaFolder, const std::int32_t& priority)
+{
+	std::lock_guard<std::mutex> l(DokanImpl::GetMutex());
+	return DokanImpl::SetUploadFolderPriority(siaFolder, priority);
+}
+
+bool CSiaDokanDrive::GetUploadProgress(std::uint64_t& activeCount, std::uint32_t& progress, std::uint64_t& bytesPerSecond, std::int64_t& etaSeconds) const
+{
+	std::lock_guard<std::mutex> l(DokanImpl::GetMutex());
+	return DokanImpl::GetUploadProgress(activeCount, progress, bytesPerSecond, etaSeconds);
+}